@@ -0,0 +1,80 @@
+// Bench.cpp
+// anksilae@gmail.com
+
+// Measures ns/element of the index-driven orders with and without software prefetching,
+// then the packed-block decode under the scalar and the detected SIMD level.
+// Usage: ./build/bench [max_log2_size]   (default 24, i.e. up to 16M ints)
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include "MyContainer.hpp"
+
+using namespace std;
+using namespace containers;
+
+template <typename Order>
+static double ns_per_element(const Order &order, size_t n, long long &sink)
+{
+    auto start = chrono::steady_clock::now();
+    long long sum = 0;
+    for (int x : order)
+        sum += x;
+    auto stop = chrono::steady_clock::now();
+    sink += sum;
+    return chrono::duration<double, nano>(stop - start).count() / static_cast<double>(n);
+}
+
+int main(int argc, char **argv) {
+    int max_log2 = argc > 1 ? atoi(argv[1]) : 24;
+    const size_t distances[] = {0, 4, 8, 16, 32, 64};
+    long long sink = 0;
+    mt19937 rng(42);
+
+    cout << setw(10) << "n" << setw(12) << "order";
+    for (size_t d : distances)
+        cout << setw(9) << ("d=" + to_string(d));
+    cout << "   (ns/element)" << endl;
+
+    for (int log2 = 16; log2 <= max_log2; log2 += 2) {
+        size_t n = size_t{1} << log2;
+        MyContainer<int> c;
+        for (size_t i = 0; i < n; ++i)
+            c.add(static_cast<int>(rng()));
+        c.sorted_indices(); // build the cache outside the timed loops
+
+        auto row = [&](const char *name, auto make_order) {
+            cout << setw(10) << n << setw(12) << name;
+            for (size_t d : distances) {
+                set_prefetch_distance(d);
+                ns_per_element(make_order(), n, sink); // warm-up
+                cout << setw(9) << fixed << setprecision(2) << ns_per_element(make_order(), n, sink);
+            }
+            cout << endl;
+        };
+        row("Ascending", [&] { return c.Ascending(); });
+        row("Descending", [&] { return c.Descending(); });
+        row("SideCross", [&] { return c.SideCross(); });
+    }
+    set_prefetch_distance(16);
+
+    cout << endl << setw(10) << "n" << setw(12) << "packed" << setw(9) << "scalar" << setw(9) << "simd" << "   (ns/element)" << endl;
+    const simd::Level detected = simd::level();
+    for (int log2 = 16; log2 <= max_log2; log2 += 2) {
+        size_t n = size_t{1} << log2;
+        PackedContainer<int> p;
+        for (size_t i = 0; i < n; ++i)
+            p.add(static_cast<int>(rng() % 100000));
+        cout << setw(10) << n << setw(12) << "Normal";
+        for (simd::Level l : {simd::Level::Scalar, detected}) {
+            simd::set_level(l);
+            ns_per_element(p.Normal(), n, sink); // warm-up
+            cout << setw(9) << fixed << setprecision(2) << ns_per_element(p.Normal(), n, sink);
+        }
+        cout << endl;
+    }
+    simd::set_level(detected);
+    return sink == 42 ? 1 : 0;
+}
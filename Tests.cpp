@@ -5,9 +5,81 @@
 #include "include/doctest.h"
 
 #include "MyContainer.hpp"
+#include "SetOperations.hpp"
+#include "external/ExternalSort.hpp"
+#include "io/BulkLoader.hpp"
+#include "numa/Numa.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#if defined(__linux__)
+#include <dlfcn.h>
+#include <pthread.h>
+#endif
 
 using namespace containers;
 
+// Global allocation hook for the allocation-budget tests: every operator new in the process
+// bumps this counter. Tests read it before and after a hot path and assert on the difference.
+static std::atomic<size_t> heap_allocations{0};
+
+void *operator new(size_t bytes)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(bytes == 0 ? 1 : bytes))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t bytes, std::align_val_t align)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t alignment = static_cast<size_t>(align);
+    if (void *p = std::aligned_alloc(alignment, (bytes + alignment - 1) / alignment * alignment))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t bytes) { return operator new(bytes); }
+void *operator new[](size_t bytes, std::align_val_t align) { return operator new(bytes, align); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+/// @brief Number of heap allocations made while running f.
+template <typename F>
+size_t allocations_during(F &&f)
+{
+    size_t before = heap_allocations.load(std::memory_order_relaxed);
+    f();
+    return heap_allocations.load(std::memory_order_relaxed) - before;
+}
+
+// Thread-start hook for the spawn-failure tests: while spawn_budget is non-negative, each
+// pthread_create uses one unit and fails with EAGAIN once it is spent, the way std::thread
+// fails when the process is out of threads. Sanitizers interpose pthread_create themselves.
+#if defined(__linux__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+#define CONTAINERS_TEST_SPAWN_HOOK 1
+static std::atomic<int> spawn_budget{-1};
+
+extern "C" int pthread_create(pthread_t *thread, const pthread_attr_t *attr, void *(*start)(void *), void *arg)
+{
+    using create_fn = int (*)(pthread_t *, const pthread_attr_t *, void *(*)(void *), void *);
+    static create_fn real = reinterpret_cast<create_fn>(dlsym(RTLD_NEXT, "pthread_create"));
+    if (spawn_budget.load() >= 0 && spawn_budget.fetch_sub(1) <= 0)
+        return EAGAIN;
+    return real(thread, attr, start, arg);
+}
+#endif
+
 TEST_CASE("Add and Size")
 {
     MyContainer<int> c;
@@ -262,3 +334,1725 @@ TEST_CASE("Iterator throws when incrementing past end") {
     ++it;  // now at end
     CHECK_THROWS_AS(++it, std::out_of_range);
 }
+
+TEST_CASE("Aggregation kernels agree on every dispatch level")
+{
+    MyContainer<int> ints;
+    MyContainer<float> floats;
+    MyContainer<double> doubles;
+    for (int i = 0; i < 203; ++i)
+    {
+        int v = (i * 37) % 101 - 50;
+        ints.add(v);
+        floats.add(static_cast<float>(v));
+        doubles.add(v * 0.5);
+    }
+    ints.add(-1000000);
+    ints.add(7777777);
+
+    const simd::Level original = simd::level();
+    for (simd::Level l : {simd::Level::Scalar, simd::Level::AVX2, simd::Level::AVX512})
+    {
+        simd::set_level(l);
+        long long expected = 0;
+        for (int x : ints.Normal())
+            expected += x;
+        CHECK(ints.sum() == expected);
+        CHECK(ints.min() == -1000000);
+        CHECK(ints.max() == 7777777);
+        CHECK(ints.count(-50) == 3);
+        CHECK(ints.find(7777777) == 204);
+        CHECK(ints.find(12345) == MyContainer<int>::npos);
+
+        CHECK(floats.minmax() == std::pair<float, float>(-50.0f, 50.0f));
+        CHECK(floats.sum() == doctest::Approx(static_cast<double>(expected + 1000000 - 7777777)));
+        CHECK(floats.count(0.0f) == 2);
+
+        CHECK(doubles.min() == -25.0);
+        CHECK(doubles.max() == 25.0);
+        CHECK(doubles.find(-25.0) == 0);
+        CHECK(doubles.count(0.5) == 2);
+    }
+    simd::set_level(original);
+}
+
+TEST_CASE("min/max throw on empty container")
+{
+    MyContainer<int> c;
+    CHECK(c.sum() == 0);
+    CHECK_THROWS_AS(c.min(), std::runtime_error);
+    CHECK_THROWS_AS(c.max(), std::runtime_error);
+    CHECK(c.count(1) == 0);
+    CHECK(c.find(1) == MyContainer<int>::npos);
+}
+
+TEST_CASE("Vectorized remove keeps order on every dispatch level")
+{
+    const simd::Level original = simd::level();
+    for (simd::Level l : {simd::Level::Scalar, simd::Level::AVX2, simd::Level::AVX512})
+    {
+        simd::set_level(l);
+        MyContainer<int> ints;
+        MyContainer<double> doubles;
+        std::vector<int> expected;
+        for (int i = 0; i < 157; ++i)
+        {
+            ints.add(i % 3 == 0 ? -1 : i);
+            doubles.add(i % 3 == 0 ? -1.0 : i);
+            if (i % 3 != 0)
+                expected.push_back(i);
+        }
+        ints.remove(-1);
+        doubles.remove(-1.0);
+        REQUIRE(ints.size() == expected.size());
+        REQUIRE(doubles.size() == expected.size());
+        size_t i = 0;
+        for (int x : ints.Normal())
+            CHECK(x == expected[i++]);
+        i = 0;
+        for (double x : doubles.Normal())
+            CHECK(x == expected[i++]);
+    }
+    simd::set_level(original);
+}
+
+TEST_CASE("remove_if removes all matches and reports the count")
+{
+    MyContainer<int> c;
+    for (int i = 0; i < 10; ++i)
+        c.add(i);
+    size_t version = c.get_version();
+    CHECK(c.remove_if([](int x)
+                      { return x % 2 == 1; }) == 5);
+    CHECK(c.get_version() == version + 1);
+    std::vector<int> expected = {0, 2, 4, 6, 8};
+    size_t i = 0;
+    for (int x : c.Normal())
+        CHECK(x == expected[i++]);
+
+    CHECK(c.remove_if([](int x)
+                      { return x > 100; }) == 0);
+    CHECK(c.get_version() == version + 1);
+
+    MyContainer<std::string> s;
+    s.add("keep");
+    s.add("drop");
+    s.add("keep");
+    CHECK(s.remove_if([](const std::string &x)
+                      { return x == "drop"; }) == 1);
+    CHECK(s.size() == 2);
+}
+
+/// @brief Memory resource that forwards to another one and counts allocations.
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    size_t allocations = 0;
+
+private:
+    std::pmr::memory_resource *upstream = std::pmr::new_delete_resource();
+
+    void *do_allocate(size_t bytes, size_t align) override
+    {
+        ++allocations;
+        return upstream->allocate(bytes, align);
+    }
+    void do_deallocate(void *p, size_t bytes, size_t align) override
+    {
+        upstream->deallocate(p, bytes, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+TEST_CASE("Items and iterator index buffers come from the container's memory resource")
+{
+    CountingResource counting;
+    MyContainer<int> c(&counting);
+    CHECK(c.get_resource() == &counting);
+    for (int x = 40; x > 0; --x)
+        c.add(x);
+    size_t after_adds = counting.allocations;
+    CHECK(after_adds > 0);
+
+    int expected = 1;
+    for (int x : c.Ascending())
+        CHECK(x == expected++);
+    CHECK(counting.allocations > after_adds);
+}
+
+TEST_CASE("Container works on a monotonic arena")
+{
+    std::byte buffer[4096];
+    std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+    MyContainer<int> c(&arena);
+    for (int i = 10; i > 0; --i)
+        c.add(i);
+    c.remove(5);
+    std::vector<int> expected = {1, 10, 2, 9, 3, 8, 4, 7, 6};
+    size_t i = 0;
+    for (int x : c.SideCross())
+        CHECK(x == expected[i++]);
+}
+
+TEST_CASE("IndexPermutation uses 32-bit positions below 2^32 elements")
+{
+    CHECK_FALSE(IndexPermutation::needs_wide(0));
+    CHECK_FALSE(IndexPermutation::needs_wide(4294967295ull));
+    CHECK(IndexPermutation::needs_wide(4294967296ull));
+
+    std::vector<int> values = {5, 3, 9, 1};
+    IndexPermutation perm;
+    perm.assign_identity(values.size());
+    CHECK(perm.index_bytes() == sizeof(uint32_t));
+    perm.sort([&](size_t a, size_t b)
+              { return values[a] < values[b]; });
+    std::vector<size_t> expected = {3, 1, 0, 2};
+    REQUIRE(perm.size() == expected.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+        CHECK(perm[i] == expected[i]);
+}
+
+TEST_CASE("SideCrossOrder with even number of elements")
+{
+    MyContainer<int> c;
+    for (int x : {4, 8, 1, 6, 2, 7})
+        c.add(x);
+    std::vector<int> expected = {1, 8, 2, 7, 4, 6};
+    size_t i = 0;
+    for (int x : c.SideCross())
+        CHECK(x == expected[i++]);
+    CHECK(i == expected.size());
+}
+
+TEST_CASE("MiddleOut positions stay exact past 2^31 elements")
+{
+    using MiddleIt = MiddleOutOrder<int>::Iterator;
+
+    // Small sizes: the mapping is a permutation of [0, n).
+    for (size_t n = 1; n < 40; ++n)
+    {
+        std::vector<bool> seen(n, false);
+        for (size_t step = 0; step < n; ++step)
+        {
+            size_t pos = MiddleIt::position(n, step);
+            REQUIRE(pos < n);
+            CHECK_FALSE(seen[pos]);
+            seen[pos] = true;
+        }
+    }
+
+    for (size_t n : {(size_t{1} << 31) + 1, (size_t{1} << 32) + 6, (size_t{1} << 40) + 3})
+    {
+        size_t mid = n / 2;
+        CHECK(MiddleIt::position(n, 0) == mid);
+        CHECK(MiddleIt::position(n, 1) == mid - 1);
+        CHECK(MiddleIt::position(n, 2) == mid + 1);
+        CHECK(MiddleIt::position(n, n - 1) == (n % 2 == 0 ? 0 : n - 1));
+        CHECK(MiddleIt::position(n, n - 2) == (n % 2 == 0 ? n - 1 : 0));
+        // Steps past INT_MAX and 2^32 must not wrap.
+        size_t big = size_t{1} << 32;
+        if (big + 1 < n)
+        {
+            CHECK(MiddleIt::position(n, big) == mid + big / 2);
+            CHECK(MiddleIt::position(n, big + 1) == mid - big / 2 - 1);
+        }
+        size_t past_int = static_cast<size_t>(std::numeric_limits<int>::max()) + 1; // 2^31, even
+        CHECK(MiddleIt::position(n, past_int) == mid + past_int / 2);
+        if (past_int + 1 < n)
+            CHECK(MiddleIt::position(n, past_int + 1) == mid - past_int / 2 - 1);
+    }
+}
+
+TEST_CASE("ReverseOrder walks empty, single-element and full containers down to position 0")
+{
+    MyContainer<int> empty;
+    auto none = empty.Reverse();
+    CHECK(none.begin() == none.end());
+    CHECK_THROWS_AS(*none.begin(), std::out_of_range);
+
+    MyContainer<int> one;
+    one.add(42);
+    std::vector<int> got;
+    for (int x : one.Reverse())
+        got.push_back(x);
+    CHECK(got == std::vector<int>{42});
+
+    MyContainer<int> c;
+    for (int i = 0; i < 100000; ++i)
+        c.add(i);
+    got.clear();
+    for (int x : c.Reverse())
+        got.push_back(x);
+    REQUIRE(got.size() == 100000);
+    CHECK(got.front() == 99999);
+    CHECK(got.back() == 0); // the cursor reached position 0 and then end
+
+    // With the first and last elements tombstoned the walk still ends exactly at end().
+    c.enable_deferred_remove(0.9);
+    c.remove(0);
+    c.remove(99999);
+    auto rev = c.Reverse();
+    size_t steps = 0;
+    auto it = rev.begin();
+    CHECK(*it == 99998);
+    for (; it != rev.end(); ++it)
+        ++steps;
+    CHECK(steps == 99998);
+    CHECK_THROWS_AS(++it, std::out_of_range);
+}
+
+TEST_CASE("ReverseOrder end and bounds")
+{
+    MyContainer<int> c;
+    c.add(1);
+    c.add(2);
+    auto rev = c.Reverse();
+    auto it = rev.begin();
+    CHECK(*it == 2);
+    ++it;
+    CHECK(*it == 1);
+    ++it;
+    CHECK(it == rev.end());
+    CHECK_THROWS_AS(*it, std::out_of_range);
+    CHECK_THROWS_AS(++it, std::out_of_range);
+}
+
+TEST_CASE("SmallContainer keeps small contents and index permutations in-object")
+{
+    CountingResource counting;
+    SmallContainer<int, 16> c(&counting);
+    for (int x : {7, 15, 6, 1, 2})
+        c.add(x);
+    CHECK(c.get_items().uses_inline_storage());
+
+    std::vector<int> expected = {1, 2, 6, 7, 15};
+    size_t i = 0;
+    for (int x : c.Ascending())
+        CHECK(x == expected[i++]);
+    expected = {15, 7, 6, 2, 1};
+    i = 0;
+    for (int x : c.Descending())
+        CHECK(x == expected[i++]);
+    expected = {1, 15, 2, 7, 6};
+    i = 0;
+    for (int x : c.SideCross())
+        CHECK(x == expected[i++]);
+    expected = {6, 15, 1, 7, 2};
+    i = 0;
+    for (int x : c.MiddleOut())
+        CHECK(x == expected[i++]);
+    // Small containers sort inside the iterator, so neither the side block nor a buffer is allocated.
+    CHECK(counting.allocations == 0);
+
+    c.remove(15);
+    CHECK(c.size() == 4);
+    for (int x = 0; x < 20; ++x)
+        c.add(x);
+    CHECK_FALSE(c.get_items().uses_inline_storage());
+    CHECK(counting.allocations > 0);
+    CHECK(c.size() == 24);
+    CHECK(c.min() == 0);
+    CHECK(c.max() == 19);
+}
+
+TEST_CASE("Opt-in features do not grow every container")
+{
+    // Tombstones, history, change feed, sketch and the sorted cache live in a side block
+    // allocated on first use; in-object there is only the storage plus a few words.
+    CHECK(sizeof(MyContainer<int>) <= sizeof(std::pmr::vector<int>) + 8 * sizeof(size_t));
+    CHECK(sizeof(SmallContainer<int, 16>) <= sizeof(SmallVector<int, 16>) + 8 * sizeof(size_t));
+    // Items are read-only from outside, so no write can bypass the version and the sorted cache.
+    static_assert(std::is_const_v<std::remove_reference_t<decltype(std::declval<MyContainer<int> &>().get_items())>>);
+
+    CountingResource counting;
+    MyContainer<int> c(&counting);
+    c.add(3);
+    c.add(1);
+    size_t after_adds = counting.allocations;
+    CHECK(c.sum() == 4);
+    for (int x : c.Normal())
+        (void)x;
+    CHECK(counting.allocations == after_adds);
+}
+
+TEST_CASE("Concurrent readers share one sorted index build")
+{
+    MyContainer<int> c;
+    for (int i = 0; i < 20000; ++i)
+        c.add((i * 7919) % 20011);
+    const MyContainer<int> &shared = c;
+    std::vector<std::thread> readers;
+    std::atomic<int> sorted_runs{0};
+    for (int t = 0; t < 8; ++t)
+        readers.emplace_back([&shared, &sorted_runs, t]
+                             {
+                                 std::vector<int> seen;
+                                 if (t % 2)
+                                     for (int x : shared.Ascending())
+                                         seen.push_back(x);
+                                 else
+                                     for (int x : shared.SideCross())
+                                         seen.push_back(x);
+                                 if (seen.size() == shared.size() && (t % 2 == 0 || std::is_sorted(seen.begin(), seen.end())))
+                                     ++sorted_runs; });
+    for (std::thread &r : readers)
+        r.join();
+    CHECK(sorted_runs == 8);
+    CHECK(c.stats().index_builds == 1);
+}
+
+TEST_CASE("SmallVector copy and move keep elements")
+{
+    SmallVector<std::string, 2> a;
+    a.push_back("x");
+    a.push_back("y");
+    SmallVector<std::string, 2> b(std::move(a));
+    CHECK(a.empty());
+    REQUIRE(b.size() == 2);
+    CHECK(b[1] == "y");
+    b.push_back("z");
+    b.push_back(b[0]); // self-reference across a reallocation
+    SmallVector<std::string, 2> c(b);
+    REQUIRE(c.size() == 4);
+    CHECK(c[3] == "x");
+    c.erase(c.begin() + 1, c.begin() + 2);
+    CHECK(c.size() == 3);
+    CHECK(c[1] == "z");
+    a = std::move(c);
+    CHECK(a.size() == 3);
+    CHECK(c.empty());
+}
+
+TEST_CASE("ChunkedContainer grows without moving elements and supports all orders")
+{
+    ChunkedContainer<int, 8> c;
+    c.add(7);
+    const int *first = &c.get_items()[0];
+    for (int x : {15, 6, 1, 2})
+        c.add(x);
+    for (int x = 100; x < 130; ++x)
+        c.add(x);
+    CHECK(&c.get_items()[0] == first);
+    CHECK(c.size() == 35);
+
+    c.remove_if([](int x)
+                { return x >= 100; });
+    std::vector<int> expected = {1, 2, 6, 7, 15};
+    size_t i = 0;
+    for (int x : c.Ascending())
+        CHECK(x == expected[i++]);
+    expected = {15, 7, 6, 2, 1};
+    i = 0;
+    for (int x : c.Descending())
+        CHECK(x == expected[i++]);
+    expected = {1, 15, 2, 7, 6};
+    i = 0;
+    for (int x : c.SideCross())
+        CHECK(x == expected[i++]);
+    expected = {6, 15, 1, 7, 2};
+    i = 0;
+    for (int x : c.MiddleOut())
+        CHECK(x == expected[i++]);
+    expected = {7, 15, 6, 1, 2};
+    i = 0;
+    for (int x : c.Normal())
+        CHECK(x == expected[i++]);
+    expected = {2, 1, 6, 15, 7};
+    i = 0;
+    for (int x : c.Reverse())
+        CHECK(x == expected[i++]);
+}
+
+TEST_CASE("ChunkedContainer remove and aggregations across chunk boundaries")
+{
+    ChunkedContainer<int, 16> c;
+    std::vector<int> expected;
+    long long total = 0;
+    for (int i = 0; i < 100; ++i)
+    {
+        int v = i % 7 == 0 ? -5 : i;
+        c.add(v);
+        if (v != -5)
+        {
+            expected.push_back(v);
+            total += v;
+        }
+    }
+    CHECK(c.count(-5) == 15);
+    CHECK(c.find(-5) == 0);
+    CHECK(c.find(50) == 50);
+    c.remove(-5);
+    CHECK_THROWS_AS(c.remove(-5), std::runtime_error);
+    REQUIRE(c.size() == expected.size());
+    size_t i = 0;
+    for (int x : c.Normal())
+        CHECK(x == expected[i++]);
+    CHECK(c.sum() == total);
+    CHECK(c.min() == 1);
+    CHECK(c.max() == 99);
+
+    ChunkedContainer<std::string, 2> s;
+    for (const char *w : {"a", "b", "a", "c", "a"})
+        s.add(w);
+    s.remove("a");
+    CHECK(s.size() == 2);
+    CHECK(s.get_items()[1] == "c");
+}
+
+TEST_CASE("MyContainer<std::string> packs strings into a StringArena")
+{
+    MyContainer<std::string> c;
+    static_assert(std::is_same_v<std::decay_t<decltype(c.get_items())>, StringArena>);
+    std::vector<std::string> words = {"pear", "", "abcdefgh", "abcdefghi", "abcdefgh\xff",
+                                      "ab", std::string("ab\0", 3), "\xe9t\xe9", "Zebra",
+                                      "a much longer string than eight bytes", "abcdefghh"};
+    for (const auto &w : words)
+        c.add(w);
+
+    std::vector<std::string> sorted = words;
+    std::sort(sorted.begin(), sorted.end());
+    size_t i = 0;
+    for (const std::string &x : c.Ascending())
+        CHECK(x == sorted[i++]);
+    CHECK(i == sorted.size());
+    i = sorted.size();
+    for (const std::string &x : c.Descending())
+        CHECK(x == sorted[--i]);
+    CHECK(c.min() == sorted.front());
+    CHECK(c.max() == sorted.back());
+
+    CHECK(c.find("abcdefghi") == 3);
+    CHECK(c.find("abcdefghj") == MyContainer<std::string>::npos);
+    CHECK(c.count("ab") == 1);
+}
+
+TEST_CASE("StringArena remove compacts records and reclaims arena bytes")
+{
+    MyContainer<std::string> c;
+    std::string long_a(100, 'a'), long_b(100, 'b'), long_c(100, 'c');
+    for (int i = 0; i < 10; ++i)
+    {
+        c.add(long_a);
+        c.add(long_b);
+        c.add(long_c);
+        c.add("short");
+    }
+    CHECK(c.get_items().arena_bytes() == 3000);
+    c.remove(long_a);
+    CHECK(c.size() == 30);
+    CHECK(c.get_items().arena_bytes() == 3000); // a third is garbage: not worth rewriting yet
+    c.remove_if([&](const std::string &s)
+                { return s == "short" || s == long_b; });
+    CHECK(c.size() == 10);
+    CHECK(c.get_items().arena_bytes() == 1000);
+    for (const std::string &x : c.Normal())
+        CHECK(x == long_c);
+    CHECK_THROWS_AS(c.remove(long_a), std::runtime_error);
+}
+
+TEST_CASE("DictionaryContainer orders by rank and removes by code")
+{
+    DictionaryContainer c;
+    std::vector<std::string> rows;
+    const char *cities[] = {"paris", "oslo", "rome", "berlin", "oslo", "athens", "rome"};
+    for (int i = 0; i < 70; ++i)
+    {
+        rows.push_back(cities[i % 7]);
+        c.add(cities[i % 7]);
+    }
+    CHECK(c.get_items().dictionary_size() == 5);
+    CHECK(c.count("oslo") == 20);
+    CHECK(c.count("madrid") == 0);
+    CHECK(c.find("berlin") == 3);
+    CHECK(c.min() == "athens");
+    CHECK(c.max() == "rome");
+
+    std::vector<std::string> sorted = rows;
+    std::sort(sorted.begin(), sorted.end());
+    size_t i = 0;
+    for (const std::string &x : c.Ascending())
+        CHECK(x == sorted[i++]);
+    i = sorted.size();
+    for (const std::string &x : c.Descending())
+        CHECK(x == sorted[--i]);
+
+    c.remove("oslo");
+    CHECK(c.size() == 50);
+    CHECK(c.count("oslo") == 0);
+    CHECK_THROWS_AS(c.remove("oslo"), std::runtime_error);
+    CHECK(c.remove_if([](const std::string &s)
+                      { return s[0] == 'r'; }) == 20);
+    auto cross = c.SideCross();
+    auto it = cross.begin();
+    CHECK(*it == "athens");
+    ++it;
+    CHECK(*it == "paris");
+    CHECK(*c.Descending().begin() == "paris");
+
+    DictionaryContainer copy = c;
+    CHECK(copy.size() == 30);
+    CHECK(copy.count("paris") == 10);
+
+    // The predicate sees every element in insertion order, so stateful ones work as elsewhere.
+    int budget = 3;
+    CHECK(c.remove_if([&budget](const std::string &s)
+                      { return s == "paris" && budget-- > 0; }) == 3);
+    CHECK(c.count("paris") == 7);
+    CHECK(c.size() == 27);
+}
+
+TEST_CASE("Deferred remove marks tombstones that every order skips")
+{
+    MyContainer<int> c;
+    for (int v : {7, 15, 6, 1, 2, 9, 4})
+        c.add(v);
+    c.enable_deferred_remove(0.5);
+    const IndexPermutation *cache = &c.sorted_indices();
+    c.remove(15);
+    c.remove(1);
+    CHECK(c.tombstone_count() == 2);
+    CHECK(c.get_items().size() == 7); // nothing moved yet
+    CHECK(c.size() == 5);
+    CHECK(&c.sorted_indices() == cache);
+    CHECK_THROWS_AS(c.remove(15), std::runtime_error);
+
+    auto collect = [](auto order)
+    {
+        std::vector<int> out;
+        for (int x : order)
+            out.push_back(x);
+        return out;
+    };
+    CHECK(collect(c.Normal()) == std::vector<int>{7, 6, 2, 9, 4});
+    CHECK(collect(c.Reverse()) == std::vector<int>{4, 9, 2, 6, 7});
+    CHECK(collect(c.Ascending()) == std::vector<int>{2, 4, 6, 7, 9});
+    CHECK(collect(c.Descending()) == std::vector<int>{9, 7, 6, 4, 2});
+    CHECK(collect(c.SideCross()) == std::vector<int>{2, 9, 4, 7, 6});
+    CHECK(collect(c.MiddleOut()) == std::vector<int>{2, 6, 9, 7, 4});
+    CHECK(c.sum() == 28);
+    CHECK(c.min() == 2);
+    CHECK(c.max() == 9);
+    CHECK(c.find(2) == 2);
+    CHECK(c.find(1) == MyContainer<int>::npos);
+    CHECK(c.count(15) == 0);
+    std::ostringstream os;
+    os << c;
+    CHECK(os.str() == "[7, 6, 2, 9, 4]");
+
+    // A third tombstone crosses the 50% threshold and compacts in place.
+    size_t before = c.get_version();
+    c.remove(7);
+    CHECK(c.get_version() == before + 1);
+    c.remove(6);
+    CHECK(c.tombstone_count() == 0);
+    CHECK(c.get_items().size() == 3);
+    CHECK(collect(c.Normal()) == std::vector<int>{2, 9, 4});
+}
+
+TEST_CASE("Deferred remove works on every storage and compacts on demand")
+{
+    ChunkedContainer<int, 8> chunked;
+    MyContainer<std::string> strings;
+    for (int i = 0; i < 40; ++i)
+    {
+        chunked.add(i % 10);
+        strings.add(std::string(i % 2 ? "odd-element-" : "even-") + std::to_string(i % 5));
+    }
+    chunked.enable_deferred_remove(0.5);
+    strings.enable_deferred_remove(1.0);
+
+    chunked.remove(3);
+    CHECK(chunked.size() == 36);
+    CHECK(chunked.count(3) == 0);
+    CHECK(chunked.sum() == 4 * (45 - 3));
+    CHECK(chunked.find(4) == 3);
+    CHECK(chunked.remove_if([](int v)
+                            { return v >= 8; }) == 8);
+    CHECK(chunked.tombstone_count() == 12);
+    CHECK(chunked.compact() == 12);
+    CHECK(chunked.compact() == 0);
+    CHECK(chunked.size() == 28);
+    CHECK(chunked.get_items().size() == 28);
+    CHECK(*chunked.Descending().begin() == 7);
+
+    strings.remove("even-0");
+    CHECK(strings.size() == 36);
+    CHECK(strings.count("even-0") == 0);
+    CHECK(strings.find("odd-element-0") == 4);
+    CHECK(*strings.Ascending().begin() == "even-1");
+    strings.disable_deferred_remove();
+    CHECK(strings.tombstone_count() == 0);
+    CHECK(strings.get_items().size() == 36);
+    strings.remove("even-1");
+    CHECK(strings.size() == 32);
+
+    MyContainer<int> c;
+    CHECK_THROWS_AS(c.enable_deferred_remove(0), std::invalid_argument);
+    CHECK_THROWS_AS(c.enable_deferred_remove(1.5), std::invalid_argument);
+}
+
+TEST_CASE("at_version rebuilds earlier states from the history log")
+{
+    MyContainer<int> c;
+    c.add(5);
+    c.enable_history(8);
+    size_t start = c.get_version();
+    for (int v : {3, 9, 3, 1})
+        c.add(v);
+    size_t before_remove = c.get_version();
+    c.remove(3);
+    c.add(7);
+    CHECK(c.remove_if([](int v)
+                      { return v > 6; }) == 2);
+    CHECK(c.size() == 2);
+
+    auto collect = [](auto order)
+    {
+        std::vector<int> out;
+        for (int x : order)
+            out.push_back(x);
+        return out;
+    };
+    auto old = c.at_version(before_remove);
+    CHECK(old.get_version() == before_remove);
+    CHECK(collect(old.Normal()) == std::vector<int>{5, 3, 9, 3, 1});
+    CHECK(collect(old.Ascending()) == std::vector<int>{1, 3, 3, 5, 9});
+    auto mid = c.at_version(before_remove + 2);
+    CHECK(collect(mid.Normal()) == std::vector<int>{5, 9, 1, 7});
+    CHECK(collect(c.at_version(start).Normal()) == std::vector<int>{5});
+    CHECK(collect(c.at_version(c.get_version()).Normal()) == std::vector<int>{5, 1});
+    CHECK(c.oldest_version() == start);
+    CHECK_THROWS_AS(c.at_version(start - 1), std::out_of_range);
+    CHECK_THROWS_AS(c.at_version(c.get_version() + 1), std::out_of_range);
+
+    // The log is bounded: older versions fall off.
+    for (int i = 0; i < 10; ++i)
+        c.add(i);
+    CHECK(c.oldest_version() == c.get_version() - 8);
+    CHECK_THROWS_AS(c.at_version(before_remove), std::out_of_range);
+    CHECK(c.at_version(c.get_version() - 8).size() == 4);
+}
+
+TEST_CASE("History works with deferred remove and other storages")
+{
+    MyContainer<std::string> c;
+    c.enable_history(16);
+    c.enable_deferred_remove(0.9);
+    for (const char *s : {"pear", "fig", "a-much-longer-string", "fig"})
+        c.add(s);
+    size_t full = c.get_version();
+    c.remove("fig");
+    CHECK(c.tombstone_count() == 2);
+    c.compact();
+    CHECK(c.at_version(full).count("fig") == 2);
+    CHECK(c.at_version(full + 1).size() == 2);
+    CHECK(*c.at_version(full).Ascending().begin() == "a-much-longer-string");
+
+    ChunkedContainer<int, 4> chunked;
+    chunked.enable_history(4);
+    for (int i = 0; i < 10; ++i)
+        chunked.add(i);
+    chunked.remove(4);
+    auto snapshot = chunked.at_version(chunked.get_version() - 1);
+    CHECK(snapshot.size() == 10);
+    CHECK(snapshot.find(4) == 4);
+    chunked.disable_history();
+    CHECK_THROWS_AS(chunked.at_version(chunked.get_version() - 1), std::out_of_range);
+}
+
+TEST_CASE("Change feed delivers adds and removes to subscribers and pollers")
+{
+    MyContainer<int> c;
+    std::vector<std::string> seen;
+    size_t id = c.subscribe([&seen](const Change<int> &change)
+                            { seen.push_back((change.kind == Change<int>::Kind::Added ? "+" : "-") +
+                                             std::to_string(change.value) + "@" + std::to_string(change.position)); });
+    for (int v : {4, 8, 4, 2})
+        c.add(v);
+    c.remove(4);
+    CHECK(c.remove_if([](int v)
+                      { return v > 100; }) == 0);
+    CHECK(seen == std::vector<std::string>{"+4@0", "+8@1", "+4@2", "+2@3", "-4@0", "-4@2"});
+    CHECK(c.unsubscribe(id));
+    CHECK_FALSE(c.unsubscribe(id));
+    c.add(1);
+    CHECK(seen.size() == 6);
+
+    // Polling needs the history; without it only the current version is covered.
+    CHECK(c.changes_since(c.get_version()).empty());
+    CHECK_THROWS_AS(c.changes_since(c.get_version() - 1), std::out_of_range);
+    c.enable_history(4);
+    size_t v = c.get_version();
+    c.add(6);
+    c.remove(8);
+    c.compact(); // nothing pending: no new version
+    auto changes = c.changes_since(v);
+    REQUIRE(changes.size() == 2);
+    CHECK(changes[0].kind == Change<int>::Kind::Added);
+    CHECK(changes[0].version == v + 1);
+    CHECK(changes[0].position == 3);
+    CHECK(changes[1].kind == Change<int>::Kind::Removed);
+    CHECK(changes[1].value == 8);
+    CHECK(changes[1].position == 0);
+    CHECK(c.changes_between(v, v + 1).size() == 1);
+    CHECK_THROWS_AS(c.changes_between(v, v + 5), std::out_of_range);
+
+    MyContainer<int> copy = c;
+    copy.add(3); // copies do not inherit subscribers
+    CHECK(seen.size() == 6);
+}
+
+TEST_CASE("Set operations merge the cached sorted permutations")
+{
+    MyContainer<int> a;
+    MyContainer<int> b;
+    for (int v : {5, 1, 3, 3, 9, 7})
+        a.add(v);
+    for (int v : {3, 8, 1, 10, 3, 3})
+        b.add(v);
+    auto collect = [](const MyContainer<int> &c)
+    {
+        std::vector<int> out;
+        for (int x : c.Normal())
+            out.push_back(x);
+        return out;
+    };
+    CHECK(collect(merge(a, b)) == std::vector<int>{1, 1, 3, 3, 3, 3, 3, 5, 7, 8, 9, 10});
+    CHECK(collect(set_union(a, b)) == std::vector<int>{1, 3, 3, 3, 5, 7, 8, 9, 10});
+    CHECK(collect(set_intersection(a, b)) == std::vector<int>{1, 3, 3});
+    CHECK(collect(set_difference(a, b)) == std::vector<int>{5, 7, 9});
+    CHECK(collect(set_difference(b, a)) == std::vector<int>{3, 8, 10});
+    CHECK(merge(a, b).get_version() == 1); // published as one change, not one add() per element
+    CHECK(set_union(a, b).stats().adds == 9);
+
+    // Large results are sorted by construction: the first sorted traversal reuses that order.
+    MyContainer<int> big_a, big_b;
+    for (int i = 0; i < 5000; ++i)
+    {
+        big_a.add((i * 7919) % 5003);
+        big_b.add(i * 3);
+    }
+    auto check_presorted = [](const MyContainer<int> &result)
+    {
+        REQUIRE(result.size() > IndexPermutation::inline_positions);
+        std::vector<int> walked;
+        for (int x : result.Ascending())
+            walked.push_back(x);
+        CHECK(walked == result.to_vector(Order::Normal));
+        CHECK(std::is_sorted(walked.begin(), walked.end()));
+        CHECK(result.stats().index_builds == 0);
+        CHECK(result.stats().cache_hits >= 1);
+    };
+    check_presorted(merge(big_a, big_b));
+    check_presorted(set_union(big_a, big_b));
+    check_presorted(set_intersection(big_a, big_b));
+    check_presorted(set_difference(big_a, big_b));
+    MyContainer<int> filled;
+    filled.add(1);
+    CHECK_THROWS_AS(filled.fill_sorted(1, [](auto) {}), std::logic_error);
+    // Values that are not ascending are still stored, but the identity is not trusted.
+    MyContainer<int> unsorted;
+    unsorted.fill_sorted(40, [](auto push)
+                         { for (int i = 40; i > 0; --i) push(i); });
+    CHECK(unsorted.size() == 40);
+    CHECK(*unsorted.Ascending().begin() == 1);
+
+    // Tombstoned elements are not part of either side.
+    b.enable_deferred_remove(1.0);
+    b.remove(3);
+    CHECK(collect(set_intersection(a, b)) == std::vector<int>{1});
+    MyContainer<int> empty;
+    CHECK(collect(set_union(empty, a)) == std::vector<int>{1, 3, 3, 5, 7, 9});
+    CHECK(set_intersection(a, empty).size() == 0);
+
+    // Mixed storages: the result uses the first side's storage.
+    ChunkedContainer<int, 4> chunked;
+    for (int v : {9, 2, 7})
+        chunked.add(v);
+    auto mixed = set_union(chunked, a);
+    std::vector<int> got;
+    for (int x : mixed.Normal())
+        got.push_back(x);
+    CHECK(got == std::vector<int>{1, 2, 3, 3, 5, 7, 9});
+}
+
+TEST_CASE("Distinct and GroupedAscending yield each value once")
+{
+    MyContainer<int> c;
+    for (int i = 0; i < 1000; ++i)
+        c.add(i % 3 == 0 ? 7 : (i % 3 == 1 ? 1 : i % 5));
+    std::vector<int> distinct;
+    for (int x : c.Distinct())
+        distinct.push_back(x);
+    CHECK(distinct == std::vector<int>{0, 1, 2, 3, 4, 7});
+
+    std::map<int, size_t> expected;
+    for (int x : c.Normal())
+        ++expected[x];
+    std::vector<std::pair<int, size_t>> groups;
+    for (auto group : c.GroupedAscending())
+        groups.push_back(group);
+    CHECK(groups == std::vector<std::pair<int, size_t>>(expected.begin(), expected.end()));
+
+    // Pending tombstones drop out of the counts; a fully removed value disappears.
+    c.enable_deferred_remove(1.0);
+    c.remove(0);
+    c.remove_if([](int v)
+                { return v == 1; });
+    groups.clear();
+    for (auto group : c.GroupedAscending())
+        groups.push_back(group);
+    REQUIRE(groups.size() == 4);
+    CHECK(groups[0] == std::pair<int, size_t>(2, expected[2]));
+    CHECK(groups[3] == std::pair<int, size_t>(7, expected[7]));
+
+    MyContainer<int> empty;
+    CHECK(empty.Distinct().begin() == empty.Distinct().end());
+    auto view = c.Distinct();
+    auto it = view.begin();
+    c.add(5);
+    CHECK_THROWS_AS(*it, std::runtime_error);
+    auto end = c.Distinct().end();
+    CHECK_THROWS_AS(++end, std::out_of_range);
+}
+
+TEST_CASE("GroupedAscending on strings and dictionary storage")
+{
+    DictionaryContainer dict;
+    MyContainer<std::string> arena;
+    const char *words[] = {"kiwi", "apple", "kiwi", "fig", "apple", "kiwi"};
+    for (const char *w : words)
+    {
+        dict.add(w);
+        arena.add(w);
+    }
+    std::vector<std::pair<std::string, size_t>> expected = {{"apple", 2}, {"fig", 1}, {"kiwi", 3}};
+    std::vector<std::pair<std::string, size_t>> got;
+    for (auto group : dict.GroupedAscending())
+        got.push_back(group);
+    CHECK(got == expected);
+    got.clear();
+    for (auto group : arena.GroupedAscending())
+        got.push_back(group);
+    CHECK(got == expected);
+}
+
+TEST_CASE("Quantile sketch follows add and remove within its error bound")
+{
+    MyContainer<double> c;
+    CHECK_THROWS_AS(c.approx_quantile(0.5), std::runtime_error);
+    c.enable_quantile_sketch(0.01);
+    CHECK_THROWS_AS(c.approx_quantile(0.5), std::runtime_error); // empty
+    for (int i = 1; i <= 10000; ++i)
+        c.add(i * 0.5);
+    for (double q : {0.0, 0.5, 0.95, 0.99, 1.0})
+    {
+        double exact = c.quantile(q);
+        CHECK(std::fabs(c.approx_quantile(q) - exact) <= 0.01 * exact);
+    }
+    CHECK(c.quantile(0.5) == 2500.0);
+
+    c.remove(5000.0);
+    CHECK(c.remove_if([](double v)
+                      { return v > 2500; }) == 4999);
+    CHECK(c.quantile_sketch().count() == 5000);
+    double p99 = c.quantile(0.99);
+    CHECK(std::fabs(c.approx_quantile(0.99) - p99) <= 0.01 * p99);
+    CHECK_THROWS_AS(c.approx_quantile(1.5), std::invalid_argument);
+
+    // Negative values, zeros and merging.
+    MyContainer<int> a;
+    MyContainer<int> b;
+    for (int i = -50; i < 50; ++i)
+        (i % 2 ? a : b).add(i);
+    a.add(0);
+    a.enable_quantile_sketch(0.02);
+    b.enable_quantile_sketch(0.02);
+    QuantileSketch merged = a.quantile_sketch();
+    merged.merge(b.quantile_sketch());
+    CHECK(merged.count() == 101);
+    CHECK(merged.quantile(0) == doctest::Approx(-50).epsilon(0.02));
+    CHECK(merged.quantile(0.5) == 0);
+    CHECK(merged.quantile(1) == doctest::Approx(49).epsilon(0.02));
+    CHECK_THROWS_AS(merged.merge(QuantileSketch(0.05)), std::invalid_argument);
+    // Finer accuracies would overflow the int bucket index.
+    CHECK_THROWS_AS(QuantileSketch(1e-8), std::invalid_argument);
+    CHECK_THROWS_AS(a.enable_quantile_sketch(0), std::invalid_argument);
+    CHECK(QuantileSketch(QuantileSketch::min_relative_accuracy).count() == 0);
+    a.disable_quantile_sketch();
+    CHECK_THROWS_AS(a.quantile_sketch(), std::runtime_error);
+    CHECK(a.quantile(1) == 49);
+}
+
+TEST_CASE("Quantile sketch stays bounded over values spanning many orders of magnitude")
+{
+    // 10^-300 .. 10^300 need about 69000 buckets at a = 0.01; the store keeps max_bins per sign.
+    for (double accuracy : {0.01, QuantileSketch::min_relative_accuracy})
+    {
+        QuantileSketch sketch(accuracy);
+        std::vector<double> values;
+        for (int k = -300; k <= 300; ++k)
+        {
+            values.push_back(std::pow(10.0, k));
+            values.push_back(-std::pow(10.0, k) * 3);
+        }
+        for (double v : values)
+            sketch.add(v);
+        CHECK(sketch.count() == values.size());
+        CHECK(sketch.bin_count() <= 2 * QuantileSketch::default_max_bins);
+        std::sort(values.begin(), values.end());
+        for (double q : {0.0, accuracy == 0.01 ? 0.999 : 1.0, 1.0})
+        {
+            // The largest magnitudes of each sign are never collapsed; at a = 1e-6 the window
+            // spans only a factor of about 1.004, so only the extremes stay exact.
+            double exact = values[static_cast<size_t>(q * static_cast<double>(values.size() - 1))];
+            CHECK(std::fabs(sketch.quantile(q) - exact) <= accuracy * std::fabs(exact) * 1.0001);
+        }
+        // Removing a value from the collapsed range still uncounts it.
+        sketch.remove(1e-300);
+        sketch.remove(-3e-300);
+        CHECK(sketch.count() == values.size() - 2);
+    }
+
+    MyContainer<double> c;
+    c.enable_quantile_sketch(0.01, 64);
+    for (int k = 0; k < 10000; ++k)
+        c.add(std::exp(k * 0.01)); // e^0 .. e^100, about 5000 buckets at a = 0.01
+    CHECK(c.quantile_sketch().bin_count() <= 64);
+    CHECK(std::fabs(c.approx_quantile(1.0) - c.quantile(1.0)) <= 0.01 * c.quantile(1.0));
+    CHECK(c.approx_quantile(0.0) > c.quantile(0.0) * 1.01); // collapsed into the window's floor
+    CHECK_THROWS_AS(QuantileSketch(0.01, std::pmr::get_default_resource(), 0), std::invalid_argument);
+}
+
+TEST_CASE("Coroutine generators yield every order lazily")
+{
+    MyContainer<int> c;
+    for (int v : {7, 15, 6, 1, 2, 7})
+        c.add(v);
+    auto drain = [](auto gen)
+    {
+        std::vector<int> out;
+        for (int x : gen)
+            out.push_back(x);
+        return out;
+    };
+    CHECK(drain(c.AscendingGen()) == std::vector<int>{1, 2, 6, 7, 7, 15});
+    CHECK(drain(c.DescendingGen()) == std::vector<int>{15, 7, 7, 6, 2, 1});
+    CHECK(drain(c.NormalGen()) == std::vector<int>{7, 15, 6, 1, 2, 7});
+    CHECK(drain(c.ReverseGen()) == std::vector<int>{7, 2, 1, 6, 15, 7});
+    CHECK(drain(c.SideCrossGen()) == std::vector<int>{1, 15, 2, 7, 6, 7});
+    CHECK(drain(c.MiddleOutGen()) == std::vector<int>{1, 6, 2, 15, 7, 7});
+    CHECK(drain(c.DistinctGen()) == std::vector<int>{1, 2, 6, 7, 15});
+    std::vector<std::pair<int, size_t>> groups;
+    for (const auto &group : c.GroupedAscendingGen())
+        groups.push_back(group);
+    CHECK(groups.size() == 5);
+    CHECK(groups[3] == std::pair<int, size_t>(7, 2));
+
+    // Modifying the container while a generator is suspended is reported on resume.
+    auto gen = c.NormalGen();
+    auto it = gen.begin();
+    CHECK(*it == 7);
+    c.add(3);
+    CHECK_THROWS_AS(++it, std::runtime_error);
+
+    MyContainer<int> empty;
+    auto none = empty.AscendingGen();
+    CHECK(none.begin() == none.end());
+
+    // Moved-from, default-constructed and finished generators yield nothing instead of resuming.
+    auto source = c.NormalGen();
+    auto taken = std::move(source);
+    size_t count = 0;
+    for (int x : source)
+        count += static_cast<size_t>(x);
+    CHECK(count == 0);
+    for (int x : taken)
+        (void)x, ++count;
+    CHECK(count == c.size());
+    CHECK(taken.begin() == taken.end());
+    Generator<int> blank;
+    CHECK(blank.begin() == blank.end());
+}
+
+TEST_CASE("batched() hands out spans one buffer at a time")
+{
+    MyContainer<int> c;
+    for (int i = 10; i > 0; --i)
+        c.add(i);
+    std::vector<size_t> sizes;
+    std::vector<int> all;
+    for (std::span<const int> batch : batched(c.AscendingGen(), 4))
+    {
+        sizes.push_back(batch.size());
+        all.insert(all.end(), batch.begin(), batch.end());
+    }
+    CHECK(sizes == std::vector<size_t>{4, 4, 2});
+    CHECK(all == std::vector<int>{1, 2, 3, 4, 5, 6, 7, 8, 9, 10});
+    auto bad = batched(c.NormalGen(), 0);
+    CHECK_THROWS_AS(bad.begin(), std::invalid_argument);
+}
+
+TEST_CASE("Prefetch distance does not change traversal results")
+{
+    MyContainer<int> c;
+    ChunkedContainer<int, 8> chunked;
+    for (int i = 0; i < 100; ++i)
+    {
+        c.add((i * 37) % 101);
+        chunked.add((i * 37) % 101);
+    }
+    auto collect = [](auto order)
+    {
+        std::vector<int> out;
+        for (int x : order)
+            out.push_back(x);
+        return out;
+    };
+    CHECK(prefetch_distance() == 16);
+    auto ascending = collect(c.Ascending());
+    auto descending = collect(c.Descending());
+    auto cross = collect(c.SideCross());
+    for (size_t d : {0, 1, 99, 100, 1000})
+    {
+        set_prefetch_distance(d);
+        CHECK(collect(c.Ascending()) == ascending);
+        CHECK(collect(c.Descending()) == descending);
+        CHECK(collect(c.SideCross()) == cross);
+        CHECK(collect(chunked.SideCross()) == cross);
+    }
+
+    // Retuning while other threads iterate is allowed (and race-free under TSan).
+    std::atomic<bool> stop{false};
+    std::thread tuner([&]
+                      { for (size_t d = 0; !stop; d = (d + 7) % 64) set_prefetch_distance(d); });
+    bool same = true;
+    for (int round = 0; round < 50; ++round)
+        same &= collect(c.Ascending()) == ascending;
+    stop = true;
+    tuner.join();
+    CHECK(same);
+    set_prefetch_distance(16);
+}
+
+TEST_CASE("materialize and to_vector match the iterators for every order")
+{
+    auto collect = [](auto order)
+    {
+        std::vector<int> out;
+        for (int x : order)
+            out.push_back(x);
+        return out;
+    };
+    auto check_all = [&](const MyContainer<int> &c, size_t threads)
+    {
+        CHECK(c.to_vector(Order::Ascending, threads) == collect(c.Ascending()));
+        CHECK(c.to_vector(Order::Descending, threads) == collect(c.Descending()));
+        CHECK(c.to_vector(Order::Normal, threads) == collect(c.Normal()));
+        CHECK(c.to_vector(Order::Reverse, threads) == collect(c.Reverse()));
+        CHECK(c.to_vector(Order::MiddleOut, threads) == collect(c.MiddleOut()));
+        CHECK(c.to_vector(Order::SideCross, threads) == collect(c.SideCross()));
+    };
+
+    MyContainer<int> small;
+    for (int v : {7, 15, 6, 1, 2})
+        small.add(v);
+    check_all(small, 0);
+
+    // Large enough to be split across threads.
+    MyContainer<int> big;
+    for (int i = 0; i < 300000; ++i)
+        big.add(static_cast<int>((i * 7919LL) % 100003));
+    check_all(big, 4);
+    big.enable_deferred_remove(1.0);
+    big.remove_if([](int v)
+                  { return v % 3 == 0; });
+    CHECK(big.tombstone_count() > 0);
+    check_all(big, 4);
+
+    std::vector<int> buffer(small.size() + 2, -1);
+    CHECK(small.materialize(Order::SideCross, buffer) == 5);
+    CHECK(buffer == std::vector<int>{1, 15, 2, 7, 6, -1, -1});
+    std::vector<int> tiny(2);
+    CHECK_THROWS_AS(small.materialize(Order::Normal, tiny), std::length_error);
+
+    MyContainer<std::string> words;
+    for (const char *w : {"pear", "apple", "a-rather-long-fig-name"})
+        words.add(w);
+    CHECK(words.to_vector(Order::Ascending) == std::vector<std::string>{"a-rather-long-fig-name", "apple", "pear"});
+}
+
+TEST_CASE("External sort spills runs to disk and merges them back in order")
+{
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "containers-external-sort-test";
+    fs::create_directories(dir);
+
+    MyContainer<int> c;
+    std::vector<int> expected;
+    for (int i = 0; i < 20000; ++i)
+    {
+        int v = static_cast<int>((i * 7919LL) % 10007) - 5000;
+        c.add(v);
+        expected.push_back(v);
+    }
+    std::sort(expected.begin(), expected.end());
+
+    ExternalSortOptions options;
+    options.memory_budget = 4096; // 1024 ints per run: about 20 runs
+    options.temp_dir = dir;
+    std::vector<int> got;
+    {
+        auto sorted = external_sorted(c.NormalGen(), options);
+        CHECK(std::distance(fs::directory_iterator(dir), fs::directory_iterator()) >= 19);
+        for (int x : sorted)
+            got.push_back(x);
+    }
+    CHECK(got == expected);
+    CHECK(fs::is_empty(dir)); // run files are removed with the generator
+
+    options.descending = true;
+    got.clear();
+    for (int x : external_sorted(c.NormalGen(), options))
+        got.push_back(x);
+    CHECK(got == std::vector<int>(expected.rbegin(), expected.rend()));
+
+    // Raw binary file input, and input that fits in memory (no run files).
+    fs::path input = dir / "input.bin";
+    {
+        std::ofstream out(input, std::ios::binary);
+        std::vector<double> values = {3.5, -1.0, 2.25, 9.0, 0.0};
+        out.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(double)));
+    }
+    options.descending = false;
+    options.memory_budget = 3 * sizeof(double);
+    std::vector<double> doubles;
+    for (double x : external_sorted_file<double>(input, options))
+        doubles.push_back(x);
+    CHECK(doubles == std::vector<double>{-1.0, 0.0, 2.25, 3.5, 9.0});
+    options.memory_budget = 1 << 20;
+    doubles.clear();
+    for (double x : external_sorted_file<double>(input, options))
+        doubles.push_back(x);
+    CHECK(doubles.size() == 5);
+    {
+        std::ofstream out(input, std::ios::binary | std::ios::app);
+        out.write("xyz", 3); // a partial trailing value
+    }
+    CHECK_THROWS_AS(
+        {
+            for (double x : external_sorted_file<double>(input, options))
+                (void)x;
+        },
+        std::runtime_error);
+    fs::remove(input);
+    CHECK(fs::is_empty(dir));
+    CHECK_THROWS_AS(external_sorted_file<int>(dir / "missing.bin", options), std::runtime_error);
+    options.memory_budget = 1;
+    CHECK_THROWS_AS(external_sorted(c.NormalGen(), options), std::invalid_argument);
+
+    // Two sorts spilling into the same directory at once keep their runs apart.
+    options.memory_budget = 4096;
+    MyContainer<int> other;
+    for (int i = 0; i < 20000; ++i)
+        other.add(-i);
+    {
+        auto first = external_sorted(c.NormalGen(), options);
+        auto second = external_sorted(other.NormalGen(), options);
+        auto a = first.begin(), b = second.begin();
+        std::vector<int> from_first, from_second;
+        for (; a != first.end() && b != second.end(); ++a, ++b)
+        {
+            from_first.push_back(*a);
+            from_second.push_back(*b);
+        }
+        CHECK(from_first == expected);
+        CHECK(from_second.front() == -19999);
+        CHECK(std::is_sorted(from_second.begin(), from_second.end()));
+    }
+    CHECK(fs::is_empty(dir));
+    CHECK_THROWS_AS(external_sorted(c.NormalGen(), ExternalSortOptions{4096, dir / "missing", false}).begin(),
+                    std::runtime_error);
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Bulk loader parses files and streams in one append per block")
+{
+    namespace fs = std::filesystem;
+    fs::path path = fs::temp_directory_path() / "containers-bulk-loader-test.txt";
+    std::vector<long long> expected;
+    {
+        std::ofstream out(path);
+        for (long long i = 0; i < 600000; ++i)
+        {
+            long long v = (i * 2654435761LL) % 1000003 - 500000;
+            expected.push_back(v);
+            out << (i % 7 == 0 ? "+" : "") << v << (i % 10 == 9 ? "\n" : " \t");
+        }
+    }
+
+    MyContainer<long long> c;
+    c.add(42);
+    size_t before = c.get_version();
+    CHECK(load_text(c, path, LoadOptions{4}) == expected.size());
+    CHECK(c.get_version() == before + 1);
+    CHECK(c.size() == expected.size() + 1);
+    std::vector<long long> got = c.to_vector(Order::Normal);
+    CHECK(got.front() == 42);
+    CHECK(std::equal(expected.begin(), expected.end(), got.begin() + 1));
+
+    // Several per-thread buffers go in as one change, in order, without being concatenated first.
+    MyContainer<long long> parts;
+    parts.enable_history(4);
+    std::vector<long long> p1{1, 2}, p2, p3{3};
+    std::vector<std::span<const long long>> spans{p1, p2, p3};
+    parts.append(spans);
+    CHECK(parts.get_version() == 1);
+    CHECK(parts.to_vector(Order::Normal) == std::vector<long long>{1, 2, 3});
+    CHECK(parts.at_version(0).size() == 0);
+
+    // A small block size forces tokens to be split across reads.
+    MyContainer<long long> streamed;
+    std::ifstream in(path);
+    CHECK(load_text(streamed, in, LoadOptions{1, 4096}) == expected.size());
+    CHECK(streamed.to_vector(Order::Normal) == expected);
+    fs::remove(path);
+
+    MyContainer<double> doubles;
+    std::istringstream text("1.5 -2e3\n\n  7 ");
+    CHECK(load_text(doubles, text) == 3);
+    CHECK(doubles.to_vector(Order::Normal) == std::vector<double>{1.5, -2000.0, 7.0});
+    std::istringstream bad("1 2 x3");
+    CHECK_THROWS_AS(load_text(doubles, bad), std::invalid_argument);
+    CHECK(doubles.size() == 3);
+    CHECK_THROWS_AS(load_text(doubles, fs::path("/nonexistent/file.txt")), std::runtime_error);
+
+    MyContainer<int> appended;
+    appended.enable_history(2);
+    std::vector<int> values = {3, 1, 2};
+    appended.append(values);
+    CHECK(appended.changes_since(appended.get_version() - 1).size() == 3);
+    CHECK(appended.at_version(appended.get_version() - 1).size() == 0);
+}
+
+TEST_CASE("PackedContainer bit-packs small-range integers and supports every order")
+{
+    PackedContainer<int> packed;
+    MyContainer<int> plain;
+    for (int i = 0; i < 10000; ++i)
+    {
+        int v = 100000 + (i * 37) % 200 - (i % 5 == 0 ? 50 : 0);
+        packed.add(v);
+        plain.add(v);
+    }
+    CHECK(packed.get_items().packed_bytes() * 3 < plain.size() * sizeof(int));
+    for (Order order : {Order::Normal, Order::Reverse, Order::Ascending, Order::Descending, Order::MiddleOut, Order::SideCross})
+        CHECK(packed.to_vector(order) == plain.to_vector(order));
+    std::vector<int> normal, reverse;
+    for (int x : packed.Normal())
+        normal.push_back(x);
+    for (int x : packed.Reverse())
+        reverse.push_back(x);
+    CHECK(normal == plain.to_vector(Order::Normal));
+    CHECK(reverse == plain.to_vector(Order::Reverse));
+    CHECK(packed.sum() == plain.sum());
+    CHECK(packed.minmax() == plain.minmax());
+    CHECK(packed.count(100037) == plain.count(100037));
+    CHECK(packed.find(100074) == plain.find(100074));
+    CHECK(packed.find(5) == MyContainer<int>::npos);
+
+    packed.remove(100037);
+    plain.remove(100037);
+    CHECK(packed.remove_if([](int v)
+                           { return v < 100000; }) == plain.remove_if([](int v)
+                                                                      { return v < 100000; }));
+    CHECK(packed.to_vector(Order::Normal) == plain.to_vector(Order::Normal));
+    CHECK(packed.size() == plain.size());
+}
+
+TEST_CASE("PackedStorage handles negative, constant and full-width 64-bit blocks")
+{
+    PackedContainer<int64_t> c;
+    std::vector<int64_t> expected;
+    for (int i = 0; i < 128; ++i)
+        expected.push_back(-7); // zero-width block
+    for (int i = 0; i < 128; ++i)
+        expected.push_back(i % 2 ? std::numeric_limits<int64_t>::max() : std::numeric_limits<int64_t>::min());
+    for (int i = 0; i < 130; ++i)
+        expected.push_back(-1000 + i);
+    for (int64_t v : expected)
+        c.add(v);
+    CHECK(c.to_vector(Order::Normal) == expected);
+    for (size_t i = 0; i < expected.size(); ++i)
+        CHECK(c.get_items()[i] == expected[i]);
+    CHECK(c.min() == std::numeric_limits<int64_t>::min());
+    CHECK(c.max() == std::numeric_limits<int64_t>::max());
+}
+
+TEST_CASE("Packed block decode agrees across SIMD levels for every bit width")
+{
+    PackedContainer<int64_t> wide;
+    PackedContainer<int> narrow;
+    std::vector<int64_t> expected_wide;
+    std::vector<int> expected_narrow;
+    for (uint32_t bits = 0; bits <= 64; ++bits)
+        for (size_t i = 0; i < 128; ++i)
+        {
+            // One block per width: the first value is the block minimum, the second spans the full range.
+            uint64_t span = bits == 64 ? ~uint64_t{0} : (uint64_t{1} << bits) - 1;
+            uint64_t offset = i == 0 ? 0 : i == 1 ? span : (i * 0x9E3779B97F4A7C15ull) & span;
+            int64_t v = static_cast<int64_t>(static_cast<uint64_t>(std::numeric_limits<int64_t>::min()) + offset);
+            wide.add(v);
+            expected_wide.push_back(v);
+            if (bits <= 32)
+            {
+                int n = static_cast<int>(static_cast<int64_t>(std::numeric_limits<int>::min()) + static_cast<int64_t>(offset));
+                narrow.add(n);
+                expected_narrow.push_back(n);
+            }
+        }
+    for (int i = 0; i < 77; ++i) // partial trailing block
+    {
+        wide.add(i * 3);
+        expected_wide.push_back(i * 3);
+        narrow.add(-i);
+        expected_narrow.push_back(-i);
+    }
+
+    const simd::Level original = simd::level();
+    for (simd::Level l : {simd::Level::Scalar, simd::Level::AVX2})
+    {
+        simd::set_level(l);
+        CHECK(wide.to_vector(Order::Normal) == expected_wide);
+        CHECK(narrow.to_vector(Order::Normal) == expected_narrow);
+        std::vector<int64_t> reversed(expected_wide.rbegin(), expected_wide.rend());
+        CHECK(wide.to_vector(Order::Reverse) == reversed);
+        std::vector<int> walked;
+        for (int x : narrow.Normal())
+            walked.push_back(x);
+        CHECK(walked == expected_narrow);
+    }
+    simd::set_level(original);
+
+    // The decoded block lives in the range, not in each iterator.
+    auto range = narrow.Normal();
+    CHECK(sizeof(range.begin()) < PackedStorage<int>::block_size * sizeof(int) / 4);
+}
+
+TEST_CASE("A packed range traversed again after a mutation decodes the new contents")
+{
+    PackedContainer<int> c;
+    for (int i = 0; i < 300; ++i)
+        c.add(i);
+    auto normal = c.Normal();
+    auto reverse = c.Reverse();
+    CHECK(*normal.begin() == 0);
+    CHECK(*reverse.begin() == 299);
+    c.remove_if([](int v)
+                { return v < 10; });
+    long long sum = 0;
+    for (int x : normal)
+        sum += x;
+    CHECK(sum == 44805);
+    std::vector<int> back;
+    for (int x : reverse)
+        back.push_back(x);
+    CHECK(back.back() == 10);
+    CHECK(back.size() == 290);
+
+    // Assignment can repeat the version number, so a new traversal always decodes afresh.
+    PackedContainer<int> other;
+    for (int i = 0; i < 300; ++i)
+        other.add(-i);
+    c = other;
+    std::vector<int> now;
+    for (int x : normal)
+        now.push_back(x);
+    CHECK(now == other.to_vector(Order::Normal));
+}
+
+TEST_CASE("NumaResource places items and indices, and local traversal visits every live element once")
+{
+    CHECK(numa::node_count() >= 1);
+    CHECK(numa::node_count() == numa::nodes().size());
+    numa::NumaResource interleaved(numa::Placement::Interleave, 0, 4096);
+    MyContainer<int> c(&interleaved);
+    for (int i = 0; i < 100000; ++i)
+        c.add(i % 1000);
+    std::vector<int> sorted;
+    for (int x : c.Ascending())
+        sorted.push_back(x);
+    CHECK(std::is_sorted(sorted.begin(), sorted.end()));
+    if (numa::node_count() == 1)
+        CHECK(interleaved.placed_blocks() == 0);
+
+    c.enable_deferred_remove(0.9);
+    c.remove(7);
+    std::atomic<long long> total{0};
+    std::atomic<size_t> seen{0};
+    numa::for_each_local_segment(c, [&](size_t node, const int *data, size_t n)
+                                 {
+                                     CHECK(node < 64);
+                                     long long s = 0;
+                                     for (size_t i = 0; i < n; ++i)
+                                         s += data[i];
+                                     total += s;
+                                     seen += n; }, 2, 1000);
+    CHECK(seen == c.size());
+    CHECK(total == static_cast<long long>(c.sum()));
+
+    numa::NumaResource partitioned(numa::Placement::RoundRobin, 0, 4096);
+    ChunkedContainer<int, 4096> chunked(&partitioned);
+    for (int i = 0; i < 50000; ++i)
+        chunked.add(i);
+    std::atomic<size_t> chunks{0};
+    seen = 0;
+    numa::for_each_local_segment(chunked, [&](size_t, const int *, size_t n)
+                                 { ++chunks; seen += n; });
+    CHECK(seen == 50000);
+    CHECK(chunks == (50000 + 4095) / 4096);
+}
+
+TEST_CASE("Partition placement splits one vector across nodes and local traversal cuts on node boundaries")
+{
+    numa::NumaResource partition(numa::Placement::Partition, 0, 4096);
+    CHECK(partition.placement_policy() == numa::Placement::Partition);
+    MyContainer<int> c(&partition);
+    for (int i = 0; i < 200000; ++i)
+        c.add(i);
+    if (numa::node_count() == 1)
+        CHECK(partition.placed_blocks() == 0);
+
+    std::atomic<long long> total{0};
+    std::atomic<size_t> seen{0};
+    std::atomic<size_t> straddling{0};
+    numa::for_each_local_segment(c, [&](size_t node, const int *data, size_t n)
+                                 {
+                                     if (numa::node_of(data) != node || numa::node_of(data + n - 1) != node)
+                                         ++straddling;
+                                     long long s = 0;
+                                     for (size_t i = 0; i < n; ++i)
+                                         s += data[i];
+                                     total += s;
+                                     seen += n; }, 2, 3000);
+    CHECK(straddling == 0);
+    CHECK(seen == c.size());
+    CHECK(total == static_cast<long long>(c.sum()));
+}
+
+TEST_CASE("for_each_local_segment joins every worker before rethrowing")
+{
+    MyContainer<int> c;
+    for (int i = 0; i < 100000; ++i)
+        c.add(i);
+    std::atomic<size_t> calls{0};
+    CHECK_THROWS_AS(numa::for_each_local_segment(c, [&](size_t, const int *data, size_t)
+                                                 {
+                                                     ++calls;
+                                                     if (*data == 0)
+                                                         throw std::runtime_error("first piece"); }, 4, 1024),
+                    std::runtime_error);
+    CHECK(calls > 1); // the other workers ran to completion
+}
+
+#ifdef CONTAINERS_TEST_SPAWN_HOOK
+TEST_CASE("A worker thread that cannot be started is rethrown, not fatal")
+{
+    MyContainer<int> c;
+    for (int i = 0; i < 1 << 17; ++i)
+        c.add(i % 1000);
+    std::vector<int> out(c.size());
+    std::atomic<size_t> slices{0};
+
+    spawn_budget = 2; // the third thread fails to start
+    CHECK_THROWS_AS(parallel_chunks(1000, 1, [&](size_t, size_t)
+                                    { ++slices; }, 8),
+                    std::system_error);
+    spawn_budget = 0; // 2^17 elements give materialize two slices, so one spawned worker
+    CHECK_THROWS_AS(c.materialize(Order::Ascending, out, 8), std::system_error);
+    spawn_budget = 1;
+    CHECK_THROWS_AS(numa::for_each_local_segment(c, [](size_t, const int *, size_t) {}, 4, 1024),
+                    std::system_error);
+    spawn_budget = -1;
+    CHECK(slices == 2); // the started workers ran and were joined
+
+    CHECK(c.materialize(Order::Ascending, out, 8) == c.size());
+    CHECK(std::is_sorted(out.begin(), out.end()));
+}
+#endif
+
+TEST_CASE("stats() counts mutations, index builds, cache use and invalidations")
+{
+    MyContainer<int> c;
+    for (int i = 0; i < 100; ++i)
+        c.add(i % 10);
+    std::vector<int> more{1, 2, 3};
+    c.append(more);
+    c.remove(3);
+    CHECK_THROWS_AS(c.remove(42), std::runtime_error);
+    CHECK(c.remove_if([](int v)
+                      { return v == 9; }) == 10);
+
+    for (int x : c.Ascending())
+        (void)x;
+    for (int x : c.Descending())
+        (void)x;
+    auto it = c.Normal().begin();
+    c.add(5);
+    CHECK_THROWS_AS(*it, std::runtime_error);
+
+    ContainerStats s = c.stats();
+    CHECK(s.adds == 104);
+    CHECK(s.removes == 21);
+    CHECK(s.failed_removes == 1);
+    CHECK(s.index_builds == 1);
+    CHECK(s.cache_misses == 1);
+    CHECK(s.cache_hits >= 1);
+    CHECK(s.index_bytes == 82 * sizeof(uint32_t));
+    CHECK(s.invalidations == 1);
+    std::string json = s.to_json();
+    CHECK(json.front() == '{');
+    CHECK(json.find("\"adds\":104") != std::string::npos);
+    CHECK(json.find("\"invalidations\":1}") != std::string::npos);
+
+    // Counters must not cost containers their noexcept move (std::vector would copy them).
+    static_assert(std::is_nothrow_move_constructible_v<MyContainer<int>>);
+    static_assert(std::is_nothrow_move_constructible_v<ChunkedContainer<int>>);
+    MyContainer<int> copy = c;
+    CHECK(copy.stats().adds == 104);
+    c.reset_stats();
+    CHECK(c.stats().adds == 0);
+}
+
+TEST_CASE("Tracing records phases as Chrome trace events only while enabled")
+{
+    trace::Tracer &tracer = trace::Tracer::instance();
+    tracer.clear();
+    MyContainer<int> c;
+    for (int i = 0; i < 1000; ++i)
+        c.add((i * 31) % 1000);
+    for (int x : c.Ascending())
+        (void)x;
+    CHECK(tracer.snapshot().empty());
+
+    tracer.enable();
+    c.add(-1);
+    for (int x : c.Ascending())
+        (void)x;
+    std::vector<int> out(c.size());
+    c.materialize(Order::Descending, out);
+    c.enable_deferred_remove(0.9);
+    c.remove(5);
+    c.compact();
+    MyContainer<int> appended;
+    std::vector<int> batch(100, 1);
+    appended.append(batch); // grows from empty
+    tracer.disable();
+
+    std::vector<std::string> names;
+    for (const trace::Event &e : tracer.snapshot())
+        names.push_back(e.name);
+    for (const char *phase : {"sorted_index.build", "materialize", "compact", "add.grow"})
+        CHECK(std::find(names.begin(), names.end(), phase) != names.end());
+
+    std::string json = tracer.to_chrome_json();
+    CHECK(json.find("{\"traceEvents\":[") == 0);
+    CHECK(json.find("\"name\":\"materialize\",\"cat\":\"containers\",\"ph\":\"X\"") != std::string::npos);
+    std::string path = (std::filesystem::temp_directory_path() / "containers_trace_test.json").string();
+    tracer.write_chrome_json(path);
+    CHECK(std::filesystem::file_size(path) == json.size());
+    std::filesystem::remove(path);
+    tracer.clear();
+
+    // The buffer is a ring: a long traced run keeps only the newest events.
+    tracer.set_capacity(4);
+    tracer.enable();
+    for (uint64_t n = 0; n < 10; ++n)
+    {
+        CONTAINERS_TRACE_SCOPE("ring", n);
+    }
+    tracer.disable();
+    std::vector<trace::Event> kept = tracer.snapshot();
+    REQUIRE(kept.size() == 4);
+    for (size_t i = 0; i < kept.size(); ++i)
+        CHECK(kept[i].size == 6 + i);
+    CHECK(tracer.dropped() == 6);
+    tracer.set_capacity(size_t{1} << 16);
+    tracer.clear();
+}
+
+TEST_CASE("Allocation budget: Normal and Reverse traversals never allocate")
+{
+    MyContainer<int> c;
+    ChunkedContainer<int, 1024> chunked;
+    for (int i = 0; i < 10000; ++i)
+    {
+        c.add((i * 7919) % 10007);
+        chunked.add(i);
+    }
+    long long sum = 0;
+    CHECK(allocations_during([&]
+                             {
+                                 for (int x : c.Normal())
+                                     sum += x;
+                                 for (int x : c.Reverse())
+                                     sum += x;
+                                 for (int x : chunked.Normal())
+                                     sum += x;
+                                 for (int x : chunked.Reverse())
+                                     sum += x; }) == 0);
+    CHECK(sum != 0);
+
+    c.enable_deferred_remove(0.9);
+    c.remove(c.get_items()[0]);
+    CHECK(allocations_during([&]
+                             {
+                                 for (int x : c.Normal())
+                                     sum += x;
+                                 for (int x : c.Reverse())
+                                     sum += x; }) == 0);
+}
+
+TEST_CASE("Allocation budget: a cached Ascending traversal never allocates")
+{
+    MyContainer<int> c;
+    for (int i = 0; i < 10000; ++i)
+        c.add((i * 7919) % 10007);
+    long long sum = 0;
+    size_t first = allocations_during([&]
+                                      {
+                                          for (int x : c.Ascending())
+                                              sum += x; });
+    CHECK(first > 0); // builds the sorted index once
+    CHECK(allocations_during([&]
+                             {
+                                 for (int x : c.Ascending())
+                                     sum += x;
+                                 for (int x : c.Descending())
+                                     sum += x;
+                                 for (int x : c.SideCross())
+                                     sum += x; }) == 0);
+    CHECK(sum != 0);
+}
+
+TEST_CASE("Allocation budget: add() makes amortized O(1) allocations")
+{
+    MyContainer<int> c;
+    constexpr int n = 1 << 17;
+    size_t allocations = allocations_during([&]
+                                            {
+                                                for (int i = 0; i < n; ++i)
+                                                    c.add(i); });
+    // Geometric growth: about log2(n) reallocations, not one per add.
+    CHECK(allocations <= 2 * 17 + 4);
+
+    ChunkedContainer<int, 4096> chunked;
+    allocations = allocations_during([&]
+                                     {
+                                         for (int i = 0; i < n; ++i)
+                                             chunked.add(i); });
+    CHECK(allocations <= n / 4096 + 2 * 6 + 4); // one per chunk plus the chunk table's growth
+}
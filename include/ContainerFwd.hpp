@@ -0,0 +1,75 @@
+// anksilae@gmail.com
+
+
+/// @file ContainerFwd.hpp
+/// @brief Forward declaration of MyContainer and its default storage, shared by the iterator headers.
+#pragma once
+#include <vector>
+#include <memory_resource>
+#include <concepts>
+#include <string>
+#include "storage/StringArena.hpp"
+
+namespace containers
+{
+
+    /// @brief Storage used by MyContainer<T> when none is given explicitly.
+    template <typename T>
+    struct default_storage
+    {
+        using type = std::pmr::vector<T>;
+    };
+
+    /// @brief std::string elements are packed into a StringArena unless another storage is chosen.
+    template <>
+    struct default_storage<std::string>
+    {
+        using type = StringArena;
+    };
+
+    template <typename T>
+    using default_storage_t = typename default_storage<T>::type;
+
+    /// @brief Storage that keeps all elements in one array (std::pmr::vector, SmallVector).
+    /// @details Other storages (SegmentedVector, StringArena) provide their own remove() and
+    /// remove_if() instead of data() and erase().
+    template <typename S>
+    concept contiguous_storage = requires(const S &s) {
+        { s.data() } -> std::convertible_to<const typename S::value_type *>;
+    };
+
+    /// @brief Storage that offers contiguous runs of elements, either one (contiguous_storage)
+    /// or several through for_each_segment(f(data, n)) like SegmentedVector.
+    template <typename S>
+    concept segmented_storage = contiguous_storage<S> || requires(const S &s) {
+        s.for_each_segment([](const typename S::value_type *, size_t) {});
+    };
+
+    /// @brief Compares elements a and b of a storage, using its own less() when it has one
+    /// (StringArena compares packed prefixes instead of building std::string copies).
+    template <typename S>
+    bool storage_less(const S &items, size_t a, size_t b)
+    {
+        if constexpr (requires { items.less(a, b); })
+            return items.less(a, b);
+        else
+            return items[a] < items[b];
+    }
+
+    /// @brief The traversal orders, for APIs that take the order as a value (materialize()).
+    enum class Order
+    {
+        Ascending,
+        Descending,
+        Normal,
+        Reverse,
+        MiddleOut,
+        SideCross
+    };
+
+    /// @brief Generic container; Storage provides push_back, size, empty, operator[] and
+    /// get_allocator, plus either contiguous data()/erase() or segment-wise access.
+    template <typename T = int, typename Storage = default_storage_t<T>>
+    class MyContainer;
+
+}
@@ -8,34 +8,979 @@
 
 #pragma once
 #include <vector>
+#include <memory_resource>
 #include <iostream>
 #include <stdexcept>
 #include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <cstdint>
+#include <span>
+#include <optional>
+#include <atomic>
+#include <mutex>
+#include <chrono>
 
+#include "ContainerFwd.hpp"
+#include "simd/Kernels.hpp"
+#include "storage/SmallVector.hpp"
+#include "storage/SegmentedVector.hpp"
+#include "storage/DictionaryStorage.hpp"
+#include "storage/PackedStorage.hpp"
+#include "iterators/IndexPermutation.hpp"
+#include "history/VersionHistory.hpp"
+#include "history/ChangeFeed.hpp"
+#include "sketch/QuantileSketch.hpp"
+#include "coro/Generator.hpp"
+#include "Parallel.hpp"
+#include "Stats.hpp"
+#include "trace/Trace.hpp"
 #include "iterators/AscendingOrder.hpp"
 #include "iterators/DescendingOrder.hpp"
 #include "iterators/SideCrossOrder.hpp"
 #include "iterators/ReverseOrder.hpp"
 #include "iterators/NormalOrder.hpp"
 #include "iterators/MiddleOutOrder.hpp"
+#include "iterators/DistinctOrder.hpp"
+#include "iterators/GroupedAscendingOrder.hpp"
 
 namespace containers
 {
 
-    template <typename T = int>
+    template <typename T, typename Storage>
     class MyContainer
     {
     private:
-        std::vector<T> items;
+        Storage items;
         size_t version = 0; // מזהה גרסה של הקונטיינר
 
+        size_t dead_count = 0; ///< Tombstoned elements in items (see Extras::dead).
+
+        /// @brief State that only exists once a feature needs it, so that a container which
+        /// just adds and scans stays a few words in size. Allocated from the container's
+        /// resource on first use and kept until the container is destroyed.
+        struct Extras
+        {
+            std::pmr::memory_resource *resource; ///< The resource this object came from.
+
+            // Tombstones: in deferred mode remove() only marks positions here and the items are
+            // compacted later. Bit i set = items[i] is removed. Sized lazily, missing words are live.
+            std::pmr::vector<uint64_t> dead;
+            double compaction_threshold = 0; ///< 0 = compact on every remove (the default).
+
+            VersionHistory<T> history; ///< Per-version deltas for at_version(); empty unless enabled.
+            ChangeFeed<T> feed;        ///< Subscribers notified of every add and remove.
+
+            std::optional<QuantileSketch> sketch; ///< Maintained by add()/remove() once enabled.
+
+            // Sorted-permutation cache shared by Ascending, Descending and SideCross. Mutations
+            // that move elements clear sorted_fresh (marking tombstones does not). Const readers
+            // on several threads rebuild it under sorted_lock and publish it with release/acquire.
+            IndexPermutation sorted_cache;
+            std::atomic<bool> sorted_fresh{false};
+            std::mutex sorted_lock;
+            IndexCounters index_counters;
+
+            explicit Extras(std::pmr::memory_resource *res)
+                : resource(res), dead(res), history(res), sorted_cache(res) {}
+        };
+
+        mutable std::atomic<Extras *> extras{nullptr};
+        mutable MutationCounters counters; ///< Read through stats(); the rest live in Extras.
+
+        /// @brief The extra state, or nullptr if no feature has needed it yet.
+        Extras *ext() const
+        {
+            return extras.load(std::memory_order_acquire);
+        }
+
+        /// @brief The extra state, created on first use. Safe to race from const readers: the
+        /// losing thread frees its copy.
+        Extras &ensure_extras() const
+        {
+            if (Extras *existing = ext())
+                return *existing;
+            std::pmr::polymorphic_allocator<Extras> alloc(get_resource());
+            Extras *fresh = alloc.template new_object<Extras>(get_resource());
+            Extras *expected = nullptr;
+            if (extras.compare_exchange_strong(expected, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+                return *fresh;
+            alloc.delete_object(fresh);
+            return *expected;
+        }
+
+        void free_extras()
+        {
+            if (Extras *e = extras.exchange(nullptr, std::memory_order_acq_rel))
+                std::pmr::polymorphic_allocator<Extras>(e->resource).delete_object(e);
+        }
+
+        /// @brief Replaces this container's extra state with a copy of other's (without the
+        /// sorted cache, which is rebuilt on demand, and without subscribers).
+        void copy_extras_from(const MyContainer &other)
+        {
+            free_extras();
+            if (const Extras *theirs = other.ext())
+            {
+                Extras &mine = ensure_extras();
+                mine.dead = theirs->dead;
+                mine.compaction_threshold = theirs->compaction_threshold;
+                mine.history = theirs->history;
+                mine.sketch = theirs->sketch;
+                mine.index_counters = theirs->index_counters;
+            }
+        }
+
+        /// @brief Marks the sorted cache stale after elements moved.
+        void layout_changed()
+        {
+            if (Extras *e = ext())
+                e->sorted_fresh.store(false, std::memory_order_relaxed);
+        }
+
+        /// @brief True if removals only mark tombstones.
+        bool deferred() const
+        {
+            Extras *e = ext();
+            return e && e->compaction_threshold > 0;
+        }
+
+        /// @brief Tombstone bitmap; only valid while dead_count != 0.
+        const std::pmr::vector<uint64_t> &dead_bits() const
+        {
+            return ext()->dead;
+        }
+
+        /// @brief The maintained quantile sketch, or nullptr if it is off.
+        QuantileSketch *live_sketch() const
+        {
+            Extras *e = ext();
+            return e && e->sketch ? &*e->sketch : nullptr;
+        }
+
+        /// @brief True if mutations must log their changes (for the history or the feed).
+        bool recording() const
+        {
+            Extras *e = ext();
+            return e && (e->history.enabled() || e->feed.active());
+        }
+
+        /// @brief Hands the newest delta to the subscribers.
+        void publish() const
+        {
+            Extras &e = *ext();
+            if (e.feed.active() && e.history.size() != 0)
+                e.feed.notify(e.history[e.history.size() - 1]);
+        }
+
+        bool mark_dead(size_t i)
+        {
+            std::pmr::vector<uint64_t> &dead = ensure_extras().dead;
+            if (dead.size() <= (i >> 6))
+                dead.resize((items.size() + 63) / 64, 0);
+            uint64_t bit = uint64_t{1} << (i & 63);
+            if (dead[i >> 6] & bit)
+                return false;
+            dead[i >> 6] |= bit;
+            ++dead_count;
+            return true;
+        }
+
+        /// @brief First removed position at or after pos, or the physical size.
+        size_t next_dead(size_t pos) const
+        {
+            size_t n = items.size();
+            if (dead_count == 0)
+                return n;
+            const std::pmr::vector<uint64_t> &dead = dead_bits();
+            while (pos < n && (pos >> 6) < dead.size())
+            {
+                uint64_t word = dead[pos >> 6] >> (pos & 63);
+                if (word)
+                    return std::min(pos + static_cast<size_t>(__builtin_ctzll(word)), n);
+                pos = (pos | 63) + 1;
+            }
+            return n;
+        }
+
+        /// @brief Physically drops the tombstoned elements; returns how many there were.
+        size_t compact_tombstones()
+        {
+            size_t removed = dead_count;
+            if (removed == 0)
+                return 0;
+            CONTAINERS_TRACE_SCOPE("compact", items.size());
+            size_t n = items.size();
+            if constexpr (contiguous_storage<Storage>)
+            {
+                size_t out = 0;
+                for (size_t pos = next_live(0); pos < n;)
+                {
+                    size_t end = next_dead(pos);
+                    std::move(items.begin() + static_cast<std::ptrdiff_t>(pos), items.begin() + static_cast<std::ptrdiff_t>(end),
+                              items.begin() + static_cast<std::ptrdiff_t>(out));
+                    out += end - pos;
+                    pos = next_live(end);
+                }
+                items.erase(items.begin() + static_cast<std::ptrdiff_t>(out), items.end());
+            }
+            else
+            {
+                Storage fresh(get_resource());
+                for (size_t pos = next_live(0); pos < n; pos = next_live(pos + 1))
+                    fresh.push_back(items[pos]);
+                items = std::move(fresh);
+            }
+            ext()->dead.clear();
+            dead_count = 0;
+            layout_changed();
+            return removed;
+        }
+
+        void maybe_compact()
+        {
+            if (static_cast<double>(dead_count) > ext()->compaction_threshold * static_cast<double>(items.size()))
+                compact_tombstones();
+        }
+
+        /// @brief Tombstones every live element equal to value; returns how many were marked.
+        /// @details Uses the sorted cache when it is current (O(log n + matches)); otherwise
+        /// scans, which still moves no data.
+        size_t mark_matches(const T &value)
+        {
+            size_t marked = 0;
+            Extras *e = ext();
+            if (e && e->sorted_fresh.load(std::memory_order_relaxed))
+            {
+                const IndexPermutation &perm = e->sorted_cache;
+                size_t lo = 0, hi = perm.size();
+                while (lo < hi)
+                {
+                    size_t mid = lo + (hi - lo) / 2;
+                    if (items[perm[mid]] < value)
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+                for (; lo < perm.size() && !(value < items[perm[lo]]); ++lo)
+                    marked += mark_dead(perm[lo]);
+            }
+            else
+            {
+                for (size_t pos = next_live(0); pos < items.size(); pos = next_live(pos + 1))
+                    if (items[pos] == value)
+                        marked += mark_dead(pos);
+            }
+            return marked;
+        }
+
+        /// @brief Tombstones every live element for which match returns true and logs the removed
+        /// (position, value) pairs as a new version; returns how many were removed.
+        template <typename Match>
+        size_t mark_logged(Match match)
+        {
+            std::pmr::vector<std::pair<size_t, T>> removed(get_resource());
+            size_t position = 0;
+            for (size_t pos = next_live(0); pos < items.size(); pos = next_live(pos + 1), ++position)
+            {
+                if (match(items[pos]))
+                {
+                    removed.emplace_back(position, items[pos]);
+                    mark_dead(pos);
+                }
+            }
+            size_t count = removed.size();
+            if (count != 0)
+            {
+                version++;
+                ext()->history.begin(version).removed = std::move(removed);
+            }
+            return count;
+        }
+
+        /// @brief Compacts after a logged removal: now, or at the threshold in deferred mode.
+        void settle_tombstones()
+        {
+            if (deferred())
+                maybe_compact();
+            else
+                compact_tombstones();
+        }
+
+        /// @brief Appends to items, tracing the append as "add.grow" when it reallocates.
+        void push_item(const T &value)
+        {
+#ifndef CONTAINERS_NO_TRACE
+            if constexpr (requires { items.capacity(); })
+            {
+                if (items.size() == items.capacity() && trace::Tracer::instance().enabled())
+                {
+                    CONTAINERS_TRACE_SCOPE("add.grow", items.size());
+                    items.push_back(value);
+                    return;
+                }
+            }
+#endif
+            items.push_back(value);
+        }
+
+        /// @brief Reserves room for total items; a reallocation is traced like growth in add().
+        void reserve_items(size_t total)
+        {
+#ifndef CONTAINERS_NO_TRACE
+            if constexpr (requires { items.capacity(); })
+            {
+                if (total > items.capacity() && trace::Tracer::instance().enabled())
+                {
+                    CONTAINERS_TRACE_SCOPE("add.grow", items.size());
+                    items.reserve(total);
+                    return;
+                }
+            }
+#endif
+            items.reserve(total);
+        }
+
+        /// @brief Publishes the n items pushed at physical position first onwards as one change:
+        /// counters, version, sketch and history.
+        void appended(size_t first, size_t n)
+        {
+            counters.adds.increment_owned(n);
+            version++;
+            layout_changed();
+            if constexpr (std::is_arithmetic_v<T>)
+            {
+                if (QuantileSketch *sketch = live_sketch())
+                    for (size_t k = first; k < first + n; ++k)
+                        sketch->add(static_cast<double>(items[k]));
+            }
+            if (recording())
+            {
+                auto &delta = ext()->history.begin(version);
+                delta.first_appended = first - dead_count;
+                delta.appended.reserve(n);
+                for (size_t k = first; k < first + n; ++k)
+                    delta.appended.push_back(items[k]);
+                publish();
+            }
+        }
+
+        /// @brief Counts a failed remove() and throws.
+        [[noreturn]] void not_found()
+        {
+            counters.failed_removes.increment_owned();
+            throw std::runtime_error("Element not found");
+        }
+
+        /// @brief Removes every copy of value (body of remove()).
+        void erase_value(const T &value)
+        {
+            if (recording())
+            {
+                if (mark_logged([&value](const T &x)
+                                { return x == value; }) == 0)
+                {
+                    not_found();
+                }
+                settle_tombstones();
+                publish();
+                return;
+            }
+            if (deferred())
+            {
+                if (mark_matches(value) == 0)
+                {
+                    not_found();
+                }
+                version++;
+                maybe_compact();
+                return;
+            }
+            size_t first = find(value);
+            if (first == npos)
+            {
+                not_found();
+            }
+            if constexpr (contiguous_storage<Storage>)
+            {
+                // Nothing before the first match moves, so compaction starts there.
+                CONTAINERS_TRACE_SCOPE("remove.compact", items.size() - first);
+                size_t kept = simd::remove(items.data() + first, items.size() - first, value);
+                items.erase(items.begin() + static_cast<std::ptrdiff_t>(first + kept), items.end());
+            }
+            else
+            {
+                items.remove(value);
+            }
+            version++;
+            layout_changed();
+        }
+
+        /// @brief Removes every element matching pred (body of remove_if()).
+        template <typename Pred>
+        size_t erase_matching(Pred pred)
+        {
+            size_t removed = 0;
+            if (recording())
+            {
+                removed = mark_logged(pred);
+                if (removed != 0)
+                {
+                    settle_tombstones();
+                    publish();
+                }
+                return removed;
+            }
+            if (deferred())
+            {
+                for (size_t pos = next_live(0); pos < items.size(); pos = next_live(pos + 1))
+                    if (pred(items[pos]))
+                        removed += mark_dead(pos);
+                if (removed != 0)
+                {
+                    version++;
+                    maybe_compact();
+                }
+                return removed;
+            }
+            if constexpr (contiguous_storage<Storage>)
+            {
+                CONTAINERS_TRACE_SCOPE("remove_if.compact", items.size());
+                size_t kept = simd::remove_if(items.data(), items.size(), pred);
+                removed = items.size() - kept;
+                items.erase(items.begin() + static_cast<std::ptrdiff_t>(kept), items.end());
+            }
+            else
+            {
+                removed = items.remove_if(pred);
+            }
+            if (removed != 0)
+            {
+                version++;
+                layout_changed();
+            }
+            return removed;
+        }
+
     public:
+        /// @brief Creates an empty container that allocates from the default memory resource.
+        MyContainer() = default;
+
+        /// @brief Creates an empty container whose items and iterator index buffers are
+        /// allocated from the given memory resource (e.g. a per-request monotonic arena).
+        /// @param resource Must outlive the container and every iterator created from it.
+        explicit MyContainer(std::pmr::memory_resource *resource)
+            : items(resource) {}
+
+        /// @brief Copies elements, tombstones, history and sketch; like std::pmr::vector the
+        /// copy uses the default resource. Subscribers are not copied.
+        MyContainer(const MyContainer &other)
+            : items(other.items), version(other.version), dead_count(other.dead_count), counters(other.counters)
+        {
+            copy_extras_from(other);
+        }
+
+        MyContainer(MyContainer &&other) noexcept(std::is_nothrow_move_constructible_v<Storage>)
+            : items(std::move(other.items)), version(other.version), dead_count(other.dead_count),
+              extras(other.extras.exchange(nullptr, std::memory_order_acq_rel)), counters(other.counters)
+        {
+            other.dead_count = 0;
+        }
+
+        MyContainer &operator=(const MyContainer &other)
+        {
+            if (this != &other)
+            {
+                items = other.items;
+                version = other.version;
+                dead_count = other.dead_count;
+                counters = other.counters;
+                copy_extras_from(other);
+            }
+            return *this;
+        }
+
+        MyContainer &operator=(MyContainer &&other)
+        {
+            if (this == &other)
+                return *this;
+            if (!get_resource()->is_equal(*other.get_resource()))
+            {
+                // The extra state belongs to other's resource; copy it into ours instead.
+                *this = static_cast<const MyContainer &>(other);
+                return *this;
+            }
+            items = std::move(other.items);
+            version = other.version;
+            dead_count = other.dead_count;
+            counters = other.counters;
+            free_extras();
+            extras.store(other.extras.exchange(nullptr, std::memory_order_acq_rel), std::memory_order_release);
+            other.dead_count = 0;
+            return *this;
+        }
+
+        ~MyContainer()
+        {
+            free_extras();
+        }
+
+        /// @brief Returned by find() when the value is not in the container.
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        /// @brief Switches remove()/remove_if() to tombstones: matches are only marked, and the
+        /// items are compacted once more than threshold of them are tombstones.
+        /// @param threshold Fraction of tombstones that triggers compaction, in (0, 1].
+        /// @throws std::invalid_argument if threshold is out of range.
+        void enable_deferred_remove(double threshold = 0.25)
+        {
+            if (!(threshold > 0 && threshold <= 1))
+            {
+                throw std::invalid_argument("Compaction threshold must be in (0, 1]");
+            }
+            ensure_extras().compaction_threshold = threshold;
+        }
+
+        /// @brief Compacts pending tombstones and goes back to removing immediately.
+        void disable_deferred_remove()
+        {
+            compact();
+            if (Extras *e = ext())
+                e->compaction_threshold = 0;
+        }
+
+        /// @brief Physically drops all tombstoned elements now.
+        /// @return The number of dropped elements; the version changes only if it is non-zero.
+        size_t compact()
+        {
+            size_t removed = compact_tombstones();
+            if (removed != 0)
+            {
+                version++;
+                if (recording())
+                {
+                    ext()->history.begin(version); // same elements, new layout
+                }
+            }
+            return removed;
+        }
+
+        /// @brief Starts keeping the changes of the last max_versions versions, so that
+        /// at_version() can rebuild any of them. Removals then go through tombstones so their
+        /// positions can be logged; the cost is proportional to the changes, not to n.
+        /// @throws std::invalid_argument if max_versions is 0.
+        void enable_history(size_t max_versions)
+        {
+            if (max_versions == 0)
+            {
+                throw std::invalid_argument("History must keep at least one version");
+            }
+            ensure_extras().history.enable(max_versions);
+        }
+
+        /// @brief Stops keeping history and frees the logged changes.
+        void disable_history()
+        {
+            if (Extras *e = ext())
+                e->history.disable();
+        }
+
+        /// @brief Oldest version that at_version() can still rebuild.
+        size_t oldest_version() const
+        {
+            Extras *e = ext();
+            return e ? e->history.oldest(version) : version;
+        }
+
+        /// @brief Rebuilds the container as it was at version v.
+        /// @details The snapshot is a separate container (with get_version() == v); bind it to a
+        /// variable before iterating it, e.g. `auto old = c.at_version(v); for (int x : old.Ascending())`,
+        /// because `c.at_version(v).Ascending()` in a range-for would outlive the temporary.
+        /// @throws std::out_of_range if v is newer than the container or older than the history.
+        MyContainer at_version(size_t v) const
+        {
+            Extras *e = ext();
+            if (v != version && !(e && e->history.covers(v, version)))
+            {
+                throw std::out_of_range("Version not in history");
+            }
+            std::vector<T> state;
+            state.reserve(size());
+            for (size_t pos = next_live(0); pos < items.size(); pos = next_live(pos + 1))
+                state.push_back(items[pos]);
+            if (e)
+                e->history.rewind(state, v);
+
+            MyContainer snapshot(get_resource());
+            snapshot.items.reserve(state.size());
+            for (const T &value : state)
+                snapshot.items.push_back(value);
+            snapshot.version = v;
+            return snapshot;
+        }
+
+        /// @brief Returns the changes made after version v, oldest first, for consumers that poll.
+        /// @details Reads the history, so it needs enable_history() with enough versions.
+        /// @throws std::out_of_range if the history no longer covers v.
+        std::vector<Change<T>> changes_since(size_t v) const
+        {
+            return changes_between(v, version);
+        }
+
+        /// @brief Returns the changes that took the container from version from to version to.
+        /// @throws std::out_of_range if the range is not (fully) in the history.
+        std::vector<Change<T>> changes_between(size_t from, size_t to) const
+        {
+            Extras *e = ext();
+            if (from > to || to > version || (from != version && !(e && e->history.covers(from, version))))
+            {
+                throw std::out_of_range("Version not in history");
+            }
+            std::vector<Change<T>> changes;
+            for (size_t k = 0; e && k < e->history.size(); ++k)
+            {
+                const auto &delta = e->history[k];
+                if (delta.version > from && delta.version <= to)
+                    for_each_change<T>(delta, [&changes](Change<T> change)
+                                       { changes.push_back(std::move(change)); });
+            }
+            return changes;
+        }
+
+        /// @brief Calls callback(const Change<T>&) after every add and remove from now on.
+        /// @details Callbacks run synchronously and must not modify the container or its
+        /// subscriptions. Subscribing makes removals log their positions, like enable_history().
+        /// @return An id for unsubscribe().
+        size_t subscribe(std::function<void(const Change<T> &)> callback)
+        {
+            return ensure_extras().feed.subscribe(std::move(callback));
+        }
+
+        /// @brief Cancels a subscription; returns false if the id is unknown.
+        bool unsubscribe(size_t id)
+        {
+            Extras *e = ext();
+            return e && e->feed.unsubscribe(id);
+        }
+
+        /// @brief Starts maintaining a quantile sketch on every add() and remove(), so that
+        /// approx_quantile() answers without sorting. Built from the current elements.
+        /// @param relative_accuracy Error bound of the estimates, relative to the exact value.
+        /// @param max_bins Buckets per sign before the lowest are collapsed (see QuantileSketch).
+        /// @throws std::invalid_argument if relative_accuracy is not in [QuantileSketch::min_relative_accuracy, 1)
+        /// or max_bins is 0.
+        void enable_quantile_sketch(double relative_accuracy = 0.01,
+                                    size_t max_bins = QuantileSketch::default_max_bins)
+            requires std::is_arithmetic_v<T>
+        {
+            QuantileSketch fresh(relative_accuracy, get_resource(), max_bins);
+            for (size_t pos = next_live(0); pos < items.size(); pos = next_live(pos + 1))
+                fresh.add(static_cast<double>(items[pos]));
+            ensure_extras().sketch = std::move(fresh);
+        }
+
+        /// @brief Stops maintaining the quantile sketch and frees it.
+        void disable_quantile_sketch()
+        {
+            if (Extras *e = ext())
+                e->sketch.reset();
+        }
+
+        /// @brief Returns the sketch (e.g. to merge the sketches of several containers).
+        /// @throws std::runtime_error if the sketch is not enabled.
+        const QuantileSketch &quantile_sketch() const
+        {
+            const QuantileSketch *sketch = live_sketch();
+            if (!sketch)
+            {
+                throw std::runtime_error("Quantile sketch not enabled");
+            }
+            return *sketch;
+        }
+
+        /// @brief Estimates the q-quantile (0.5 = median) from the sketch, within the
+        /// relative accuracy given to enable_quantile_sketch().
+        /// @throws std::runtime_error if the sketch is not enabled or the container is empty.
+        /// @throws std::invalid_argument if q is not in [0, 1].
+        double approx_quantile(double q) const
+            requires std::is_arithmetic_v<T>
+        {
+            return quantile_sketch().quantile(q);
+        }
+
+        /// @brief Returns the exact q-quantile: the element at rank floor(q * (size() - 1)).
+        /// @details Copies the elements and runs std::nth_element, O(n); kept for comparison
+        /// with approx_quantile().
+        /// @throws std::runtime_error if the container is empty.
+        /// @throws std::invalid_argument if q is not in [0, 1].
+        T quantile(double q) const
+        {
+            if (!(q >= 0 && q <= 1))
+            {
+                throw std::invalid_argument("Quantile must be in [0, 1]");
+            }
+            if (size() == 0)
+            {
+                throw std::runtime_error("Container is empty");
+            }
+            std::vector<T> values;
+            values.reserve(size());
+            for (size_t pos = next_live(0); pos < items.size(); pos = next_live(pos + 1))
+                values.push_back(items[pos]);
+            auto nth = values.begin() + static_cast<std::ptrdiff_t>(q * static_cast<double>(values.size() - 1));
+            std::nth_element(values.begin(), nth, values.end());
+            return *nth;
+        }
+
+        /// @brief Copies the elements, in the given order, into out[0..size()).
+        /// @details The gather reads items through the permutation of the order and is split
+        /// across threads for large containers (at least 64K elements per thread), so later
+        /// scans of out are sequential reads. Each thread writes its own slice of out.
+        /// @param threads Maximum number of threads; 0 = hardware concurrency.
+        /// @return The number of elements written (size()).
+        /// @throws std::length_error if out is smaller than size().
+        size_t materialize(Order order, std::span<T> out, size_t threads = 0) const
+        {
+            size_t n = size();
+            if (out.size() < n)
+            {
+                throw std::length_error("Output span is smaller than the container");
+            }
+            CONTAINERS_TRACE_SCOPE("materialize", n);
+            // Physical positions in step order, minus tombstones.
+            IndexPermutation live_sorted(get_resource());
+            IndexPermutation live(get_resource());
+            bool sorted_order = order == Order::Ascending || order == Order::Descending || order == Order::SideCross;
+            const IndexPermutation *perm = sorted_order ? &sorted_indices() : &live;
+            if (dead_count != 0)
+            {
+                IndexPermutation &filtered = sorted_order ? live_sorted : live;
+                filtered.reset(n);
+                if (sorted_order)
+                {
+                    for (size_t k = 0; k < perm->size(); ++k)
+                        if (is_live((*perm)[k]))
+                            filtered.push_back((*perm)[k]);
+                }
+                else
+                {
+                    for (size_t pos = next_live(0); pos < items.size(); pos = next_live(pos + 1))
+                        filtered.push_back(pos);
+                }
+                perm = &filtered;
+            }
+            bool direct = !sorted_order && dead_count == 0;
+            auto source = [&](size_t k) -> size_t
+            {
+                switch (order)
+                {
+                case Order::Ascending:
+                    return (*perm)[k];
+                case Order::Descending:
+                    return (*perm)[n - 1 - k];
+                case Order::SideCross:
+                    return (*perm)[SideCrossOrder<T, Storage>::Iterator::cross_slot(n, k)];
+                case Order::Normal:
+                    break;
+                case Order::Reverse:
+                    k = n - 1 - k;
+                    break;
+                case Order::MiddleOut:
+                    k = MiddleOutOrder<T, Storage>::Iterator::position(n, k);
+                    break;
+                }
+                return direct ? k : (*perm)[k];
+            };
+            size_t distance = prefetch_distance();
+            parallel_chunks(n, size_t{1} << 16, [&](size_t begin, size_t end)
+                            {
+                                for (size_t k = begin; k < end; ++k)
+                                {
+                                    if (distance != 0 && k + distance < end)
+                                        prefetch_item(items, source(k + distance));
+                                    out[k] = items[source(k)];
+                                } }, threads);
+            return n;
+        }
+
+        /// @brief Returns the elements in the given order as a vector (see materialize()).
+        std::vector<T> to_vector(Order order, size_t threads = 0) const
+        {
+            std::vector<T> out(size());
+            materialize(order, out, threads);
+            return out;
+        }
+
+        /// @brief Returns the number of removed elements still waiting for compaction.
+        size_t tombstone_count() const
+        {
+            return dead_count;
+        }
+
+        /// @brief True if the element at physical position i has not been removed.
+        bool is_live(size_t i) const
+        {
+            if (dead_count == 0)
+                return true;
+            const std::pmr::vector<uint64_t> &dead = dead_bits();
+            return (i >> 6) >= dead.size() || !((dead[i >> 6] >> (i & 63)) & 1);
+        }
+
+        /// @brief First live physical position at or after pos, or get_items().size().
+        size_t next_live(size_t pos) const
+        {
+            size_t n = items.size();
+            if (dead_count == 0)
+                return std::min(pos, n);
+            const std::pmr::vector<uint64_t> &dead = dead_bits();
+            while (pos < n && (pos >> 6) < dead.size())
+            {
+                uint64_t word = ~dead[pos >> 6] >> (pos & 63);
+                if (word)
+                    return std::min(pos + static_cast<size_t>(__builtin_ctzll(word)), n);
+                pos = (pos | 63) + 1;
+            }
+            return std::min(pos, n);
+        }
+
+        /// @brief One past the last live physical position below pos, or 0 if there is none.
+        size_t live_before(size_t pos) const
+        {
+            if (dead_count == 0)
+                return pos;
+            const std::pmr::vector<uint64_t> &dead = dead_bits();
+            while (pos > 0)
+            {
+                size_t i = pos - 1;
+                if ((i >> 6) >= dead.size())
+                    return pos;
+                uint64_t word = ~dead[i >> 6] & (~uint64_t{0} >> (63 - (i & 63)));
+                if (word)
+                    return (i & ~size_t{63}) + (63 - static_cast<size_t>(__builtin_clzll(word))) + 1;
+                pos = i & ~size_t{63};
+            }
+            return 0;
+        }
+
+        /// @brief Returns the physical positions of the items in ascending order, tombstones
+        /// included. Built on first use and reused until elements move (add or compaction).
+        /// @details Safe to call from several threads on a container nobody is mutating: the
+        /// first caller builds the permutation under a lock and the others wait for it.
+        const IndexPermutation &sorted_indices() const
+        {
+            Extras &e = ensure_extras();
+            if (!e.sorted_fresh.load(std::memory_order_acquire))
+            {
+                std::lock_guard<std::mutex> guard(e.sorted_lock);
+                if (!e.sorted_fresh.load(std::memory_order_relaxed))
+                {
+                    CONTAINERS_TRACE_SCOPE("sorted_index.build", items.size());
+                    auto start = std::chrono::steady_clock::now();
+                    e.sorted_cache.assign_sorted(items);
+                    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+                    e.index_counters.cache_misses.increment();
+                    e.index_counters.index_builds.increment();
+                    e.index_counters.sort_nanoseconds.increment(static_cast<uint64_t>(elapsed.count()));
+                    e.index_counters.index_bytes.increment(e.sorted_cache.size() * e.sorted_cache.index_bytes());
+                    e.sorted_fresh.store(true, std::memory_order_release);
+                    return e.sorted_cache;
+                }
+            }
+            e.index_counters.cache_hits.increment();
+            return e.sorted_cache;
+        }
+
         /// @brief Adds a value to the container and increments version.
         /// @param value The element to add.
         void add(const T &value)
         {
-            items.push_back(value);
+            push_item(value);
+            counters.adds.increment_owned();
             version++;
+            layout_changed();
+            if constexpr (std::is_arithmetic_v<T>)
+            {
+                if (QuantileSketch *sketch = live_sketch())
+                    sketch->add(static_cast<double>(value));
+            }
+            if (recording())
+            {
+                auto &delta = ext()->history.begin(version);
+                delta.first_appended = size() - 1;
+                delta.appended.push_back(value);
+                publish();
+            }
+        }
+
+        /// @brief Reserves storage for n elements in total, so a bulk load does not regrow.
+        void reserve(size_t n)
+        {
+            reserve_items(n + dead_count);
+        }
+
+        /// @brief Appends all values as a single change: the version is bumped once.
+        /// @details Grows like add(); call reserve() first when the final size is known.
+        void append(std::span<const T> values)
+        {
+            append(std::span<const std::span<const T>>(&values, 1));
+        }
+
+        /// @brief Appends several buffers in order as a single change, e.g. per-thread parse
+        /// results, without first concatenating them.
+        /// @details Room for all of them is made up front, at least doubling the capacity, so
+        /// repeated calls stay amortised O(1) per element.
+        void append(std::span<const std::span<const T>> parts)
+        {
+            size_t n = 0;
+            for (std::span<const T> part : parts)
+                n += part.size();
+            if (n == 0)
+                return;
+            size_t first = items.size();
+            if constexpr (requires { items.capacity(); })
+            {
+                if (items.size() + n > items.capacity())
+                    reserve_items(std::max(items.size() + n, items.capacity() * 2));
+            }
+            for (std::span<const T> part : parts)
+                for (const T &value : part)
+                    push_item(value);
+            appended(first, n);
+        }
+
+        /// @brief Fills an empty container with values produced in ascending order, as one change.
+        /// @details fill(push) calls push(value) for each value. The values go straight into
+        /// storage reserved for max_count of them, with no staging buffer, and if they really
+        /// were ascending (checked while pushing) the sorted-index cache is seeded with the
+        /// identity, so the first sorted traversal does not sort again. Used by SetOperations.hpp.
+        /// @throws std::logic_error if the container holds elements or tombstones.
+        template <typename Fill>
+        void fill_sorted(size_t max_count, Fill &&fill)
+        {
+            if (items.size() != 0)
+            {
+                throw std::logic_error("fill_sorted() needs an empty container");
+            }
+            reserve_items(max_count);
+            bool ascending = true;
+            fill([this, &ascending](const T &value)
+                 {
+                     push_item(value);
+                     size_t n = items.size();
+                     if (n > 1 && storage_less(items, n - 1, n - 2))
+                         ascending = false; });
+            size_t n = items.size();
+            if (n == 0)
+                return;
+            appended(0, n);
+            // Small containers sort inside their iterators (SortedView), so only seed larger ones.
+            if (ascending && n > IndexPermutation::inline_positions)
+            {
+                Extras &e = ensure_extras();
+                std::lock_guard<std::mutex> guard(e.sorted_lock);
+                e.sorted_cache.assign_identity(n);
+                e.sorted_fresh.store(true, std::memory_order_release);
+            }
         }
 
         /// @brief Removes all occurrences of a value from the container.
@@ -43,29 +988,209 @@ namespace containers
         /// @throws std::runtime_error if the element does not exist.
         void remove(const T &value)
         {
-            auto original_size = items.size();
-            items.erase(std::remove(items.begin(), items.end(), value), items.end());
-            if (items.size() == original_size)
+            // Every copy goes, so the change in size is how many were removed.
+            size_t before = size();
+            erase_value(value);
+            counters.removes.increment_owned(before - size());
+            if constexpr (std::is_arithmetic_v<T>)
             {
-                throw std::runtime_error("Element not found");
+                if (QuantileSketch *sketch = live_sketch())
+                    for (size_t k = size(); k < before; ++k)
+                        sketch->remove(static_cast<double>(value));
             }
-            version++;
+        }
+
+        /// @brief Removes every element for which pred returns true.
+        /// @param pred Predicate called once per element, in insertion order.
+        /// @return The number of removed elements (the version only changes if it is non-zero).
+        template <typename Pred>
+        size_t remove_if(Pred pred)
+        {
+            size_t removed = 0;
+            if constexpr (std::is_arithmetic_v<T>)
+            {
+                if (QuantileSketch *sketch = live_sketch())
+                {
+                    removed = erase_matching([&](const T &x)
+                                             {
+                                                 bool drop = pred(x);
+                                                 if (drop)
+                                                     sketch->remove(static_cast<double>(x));
+                                                 return drop; });
+                    counters.removes.increment_owned(removed);
+                    return removed;
+                }
+            }
+            removed = erase_matching(pred);
+            counters.removes.increment_owned(removed);
+            return removed;
         }
 
         /// @brief Returns the number of elements in the container.
         size_t size() const
         {
-            return items.size();
+            return items.size() - dead_count;
         }
 
-        /// @brief Returns a const reference to the underlying items vector.
-        const std::vector<T> &get_items() const
+        /// @brief Calls f(data, n) on each contiguous run of live elements, in insertion order.
+        /// @details One run for vector-like storage, one per chunk for SegmentedVector, further
+        /// split around pending tombstones.
+        template <typename F>
+        void for_each_segment(F &&f) const
+            requires segmented_storage<Storage>
         {
-            return items;
+            size_t base = 0;
+            auto split = [&](const T *data, size_t n)
+            {
+                if (dead_count == 0)
+                {
+                    f(data, n);
+                }
+                else
+                {
+                    for (size_t pos = next_live(base); pos < base + n;)
+                    {
+                        size_t end = std::min(next_dead(pos), base + n);
+                        f(data + (pos - base), end - pos);
+                        pos = next_live(end);
+                    }
+                }
+                base += n;
+            };
+            if constexpr (contiguous_storage<Storage>)
+            {
+                split(items.data(), items.size());
+            }
+            else
+            {
+                items.for_each_segment(split);
+            }
+        }
+
+        /// @brief Returns the sum of all elements (0 for an empty container).
+        /// @details Integer elements are summed in 64 bits.
+        simd::sum_t<T> sum() const
+            requires std::is_arithmetic_v<T>
+        {
+            simd::sum_t<T> total{};
+            for_each_segment([&total](const T *data, size_t n)
+                             { total += simd::sum(data, n); });
+            return total;
         }
 
-        /// @brief Returns a modifiable reference to the underlying items vector.
-        std::vector<T> &get_items()
+        /// @brief Returns the smallest and the largest element in one pass.
+        /// @throws std::runtime_error if the container is empty.
+        std::pair<T, T> minmax() const
+        {
+            if (size() == 0)
+            {
+                throw std::runtime_error("Container is empty");
+            }
+            size_t first = next_live(0);
+            std::pair<T, T> result(items[first], items[first]);
+            if constexpr (segmented_storage<Storage>)
+            {
+                for_each_segment([&result](const T *data, size_t n)
+                                 {
+                                     auto [lo, hi] = simd::minmax(data, n);
+                                     if (lo < result.first)
+                                         result.first = lo;
+                                     if (result.second < hi)
+                                         result.second = hi; });
+            }
+            else
+            {
+                size_t lo = first, hi = first;
+                for (size_t i = next_live(first + 1); i < items.size(); i = next_live(i + 1))
+                {
+                    if (storage_less(items, i, lo))
+                        lo = i;
+                    if (storage_less(items, hi, i))
+                        hi = i;
+                }
+                result = {items[lo], items[hi]};
+            }
+            return result;
+        }
+
+        /// @brief Returns the smallest element.
+        /// @throws std::runtime_error if the container is empty.
+        T min() const
+        {
+            return minmax().first;
+        }
+
+        /// @brief Returns the largest element.
+        /// @throws std::runtime_error if the container is empty.
+        T max() const
+        {
+            return minmax().second;
+        }
+
+        /// @brief Returns how many elements are equal to value.
+        size_t count(const T &value) const
+        {
+            if constexpr (requires { items.count(value); })
+            {
+                if (dead_count == 0)
+                    return items.count(value);
+            }
+            size_t hits = 0;
+            if constexpr (segmented_storage<Storage>)
+            {
+                for_each_segment([&](const T *data, size_t n)
+                                 { hits += simd::count(data, n, value); });
+            }
+            else
+            {
+                for (size_t pos = next_live(0); pos < items.size(); pos = next_live(pos + 1))
+                    hits += (items[pos] == value);
+            }
+            return hits;
+        }
+
+        /// @brief Returns the insertion-order index of the first element equal to value.
+        /// @return The index among the current elements, or npos if the value is not in the container.
+        size_t find(const T &value) const
+        {
+            if constexpr (requires { items.find(value); })
+            {
+                if (dead_count == 0)
+                {
+                    size_t pos = items.find(value);
+                    return pos == items.size() ? npos : pos;
+                }
+            }
+            size_t offset = 0, result = npos;
+            if constexpr (segmented_storage<Storage>)
+            {
+                for_each_segment([&](const T *data, size_t n)
+                                 {
+                                     if (result != npos)
+                                         return;
+                                     size_t pos = simd::find(data, n, value);
+                                     if (pos != n)
+                                         result = offset + pos;
+                                     offset += n; });
+            }
+            else
+            {
+                for (size_t pos = next_live(0); pos < items.size() && result == npos; pos = next_live(pos + 1), ++offset)
+                    if (items[pos] == value)
+                        result = offset;
+            }
+            return result;
+        }
+
+        /// @brief Returns the memory resource used for items and iterator index buffers.
+        std::pmr::memory_resource *get_resource() const
+        {
+            return items.get_allocator().resource();
+        }
+
+        /// @brief Returns a const reference to the underlying items vector.
+        /// @details In deferred-remove mode it still holds tombstoned elements; use is_live().
+        const Storage &get_items() const
         {
             return items;
         }
@@ -76,15 +1201,39 @@ namespace containers
             return version;
         }
 
+        /// @brief Returns a snapshot of the instrumentation counters (see Stats.hpp).
+        ContainerStats stats() const
+        {
+            Extras *e = ext();
+            return make_stats(counters, e ? &e->index_counters : nullptr);
+        }
+
+        /// @brief Zeroes the instrumentation counters.
+        void reset_stats()
+        {
+            counters.reset();
+            if (Extras *e = ext())
+                e->index_counters.reset();
+        }
+
+        /// @brief Counts an invalidated iterator and throws; called by the iterators when the
+        /// container changed under them.
+        /// @throws std::runtime_error always.
+        [[noreturn]] void throw_modified() const
+        {
+            counters.invalidations.increment();
+            throw std::runtime_error("Container modified during iteration");
+        }
+
         /// @brief Prints the container in [a, b, c] format.
-        friend std::ostream &operator<<(std::ostream &os, const MyContainer<T> &container)
+        friend std::ostream &operator<<(std::ostream &os, const MyContainer &container)
         {
             os << "[";
-            for (size_t i = 0; i < container.items.size(); ++i)
+            const char *separator = "";
+            for (size_t i = container.next_live(0); i < container.items.size(); i = container.next_live(i + 1))
             {
-                os << container.items[i];
-                if (i < container.items.size() - 1)
-                    os << ", ";
+                os << separator << container.items[i];
+                separator = ", ";
             }
             os << "]";
             return os;
@@ -92,36 +1241,114 @@ namespace containers
 
         // פונקציה שמחזירה מופע של AscendingOrder<T>
         /// @brief Returns an AscendingOrder iterator over the container.
-        AscendingOrder<T> Ascending() const
+        AscendingOrder<T, Storage> Ascending() const
         {
-            return AscendingOrder<T>(*this);
+            return AscendingOrder<T, Storage>(*this);
         }
 
         /// @brief Returns a DescendingOrder iterator over the container.
-        DescendingOrder<T> Descending() const
+        DescendingOrder<T, Storage> Descending() const
         {
-            return DescendingOrder<T>(*this);
+            return DescendingOrder<T, Storage>(*this);
         }
         /// @brief Returns a MiddleOutOrder iterator over the container.
-        MiddleOutOrder<T> MiddleOut() const
+        MiddleOutOrder<T, Storage> MiddleOut() const
         {
-            return MiddleOutOrder<T>(*this);
+            return MiddleOutOrder<T, Storage>(*this);
         }
         /// @brief Returns a NormalOrder iterator over the container.
-        NormalOrder<T> Normal() const
+        NormalOrder<T, Storage> Normal() const
         {
-            return NormalOrder<T>(*this);
+            return NormalOrder<T, Storage>(*this);
         }
         /// @brief Returns a ReverseOrder iterator over the container.
-        ReverseOrder<T> Reverse() const
+        ReverseOrder<T, Storage> Reverse() const
         {
-            return ReverseOrder<T>(*this);
+            return ReverseOrder<T, Storage>(*this);
         }
         /// @brief Returns a SideCrossOrder iterator over the container.
-        SideCrossOrder<T> SideCross() const
+        SideCrossOrder<T, Storage> SideCross() const
+        {
+            return SideCrossOrder<T, Storage>(*this);
+        }
+        /// @brief Returns a DistinctOrder iterator: each distinct value once, ascending.
+        DistinctOrder<T, Storage> Distinct() const
+        {
+            return DistinctOrder<T, Storage>(*this);
+        }
+        /// @brief Returns a GroupedAscendingOrder iterator: (value, count) pairs, ascending.
+        GroupedAscendingOrder<T, Storage> GroupedAscending() const
+        {
+            return GroupedAscendingOrder<T, Storage>(*this);
+        }
+
+        // Lazy coroutine versions of the orders. Each generator walks the matching iterator, so
+        // it throws std::runtime_error if the container changes while it is suspended. The
+        // container must outlive the generator.
+
+        /// @brief Yields the elements in ascending order, one per resume.
+        Generator<T> AscendingGen() const
+        {
+            for (T value : Ascending())
+                co_yield value;
+        }
+        /// @brief Yields the elements in descending order, one per resume.
+        Generator<T> DescendingGen() const
+        {
+            for (T value : Descending())
+                co_yield value;
+        }
+        /// @brief Yields the elements middle-out, one per resume.
+        Generator<T> MiddleOutGen() const
+        {
+            for (T value : MiddleOut())
+                co_yield value;
+        }
+        /// @brief Yields the elements in insertion order, one per resume.
+        Generator<T> NormalGen() const
+        {
+            for (T value : Normal())
+                co_yield value;
+        }
+        /// @brief Yields the elements in reverse insertion order, one per resume.
+        Generator<T> ReverseGen() const
         {
-            return SideCrossOrder<T>(*this);
+            for (T value : Reverse())
+                co_yield value;
+        }
+        /// @brief Yields the elements side-cross (min, max, 2nd min, ...), one per resume.
+        Generator<T> SideCrossGen() const
+        {
+            for (T value : SideCross())
+                co_yield value;
+        }
+        /// @brief Yields each distinct value once, ascending.
+        Generator<T> DistinctGen() const
+        {
+            for (T value : Distinct())
+                co_yield value;
+        }
+        /// @brief Yields (value, count) pairs, ascending.
+        Generator<std::pair<T, size_t>> GroupedAscendingGen() const
+        {
+            for (std::pair<T, size_t> group : GroupedAscending())
+                co_yield group;
         }
     };
 
+    /// @brief MyContainer that keeps up to InlineN elements in-object and only allocates past that.
+    template <typename T, size_t InlineN>
+    using SmallContainer = MyContainer<T, SmallVector<T, InlineN>>;
+
+    /// @brief MyContainer backed by fixed-size chunks: add() never relocates existing elements.
+    template <typename T, size_t ChunkSize = 4096>
+    using ChunkedContainer = MyContainer<T, SegmentedVector<T, ChunkSize>>;
+
+    /// @brief Dictionary-encoded string container for data with few distinct values.
+    using DictionaryContainer = MyContainer<std::string, DictionaryStorage>;
+
+    /// @brief Integer container stored as frame-of-reference + bit-packed 128-value blocks.
+    template <typename T = int>
+    using PackedContainer = MyContainer<T, PackedStorage<T>>;
+
 }
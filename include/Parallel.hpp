@@ -0,0 +1,71 @@
+// anksilae@gmail.com
+
+
+/// @file Parallel.hpp
+/// @brief Splits an index range across std::thread workers.
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace containers
+{
+
+    /// @brief Calls f(begin, end) on disjoint slices covering [0, n), in parallel.
+    /// @details Uses at most `threads` workers (0 = hardware concurrency) and gives each at
+    /// least min_per_thread indices, so small ranges run inline on the calling thread. The
+    /// first exception thrown by any slice, or a failure to start a worker, is rethrown after
+    /// all started workers have joined.
+    template <typename F>
+    void parallel_chunks(size_t n, size_t min_per_thread, F &&f, size_t threads = 0)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = std::min(threads, std::max<size_t>(1, n / std::max<size_t>(1, min_per_thread)));
+        if (threads <= 1)
+        {
+            f(size_t{0}, n);
+            return;
+        }
+        std::vector<std::exception_ptr> errors(threads);
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        size_t slice = (n + threads - 1) / threads;
+        auto run = [&](size_t t)
+        {
+            try
+            {
+                size_t begin = std::min(n, t * slice);
+                f(begin, std::min(n, begin + slice));
+            }
+            catch (...)
+            {
+                errors[t] = std::current_exception();
+            }
+        };
+        // If a thread cannot be started (std::system_error), the ones already running must
+        // still be joined: destroying a joinable std::thread calls std::terminate.
+        std::exception_ptr spawn_error;
+        try
+        {
+            for (size_t t = 1; t < threads; ++t)
+                workers.emplace_back(run, t);
+        }
+        catch (...)
+        {
+            spawn_error = std::current_exception();
+        }
+        if (!spawn_error)
+            run(0);
+        for (std::thread &w : workers)
+            w.join();
+        if (spawn_error)
+            std::rethrow_exception(spawn_error);
+        for (std::exception_ptr &e : errors)
+            if (e)
+                std::rethrow_exception(e);
+    }
+
+}
@@ -0,0 +1,148 @@
+// anksilae@gmail.com
+
+
+/// @file SetOperations.hpp
+/// @brief Sorted merge and multiset operations between two containers.
+/// @details Each side is walked through its cached sorted_indices() permutation, so a
+/// container that was already iterated in order is not sorted again, and the two sides are
+/// combined in one linear pass. Like std::set_union and friends, duplicates follow multiset
+/// rules (union keeps max(m, n) copies, intersection min(m, n), difference max(m - n, 0)).
+/// The result is a new container, in the first container's memory resource, whose insertion
+/// order is ascending. It is written straight into the result's reserved storage as one
+/// change, and the result's sorted index starts out as the identity, so iterating it in a
+/// sorted order does not sort again.
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include "MyContainer.hpp"
+
+namespace containers
+{
+
+    namespace detail
+    {
+        /// @brief Walks a container's live elements in ascending order.
+        template <typename T, typename Storage>
+        class SortedCursor
+        {
+        private:
+            const MyContainer<T, Storage> &container;
+            const IndexPermutation &perm;
+            size_t k = 0;
+            size_t distance = prefetch_distance();
+
+            void skip_removed()
+            {
+                while (k < perm.size() && !container.is_live(perm[k]))
+                    ++k;
+            }
+
+        public:
+            explicit SortedCursor(const MyContainer<T, Storage> &cont)
+                : container(cont), perm(cont.sorted_indices())
+            {
+                skip_removed();
+            }
+
+            bool done() const { return k >= perm.size(); }
+            decltype(auto) value() const { return container.get_items()[perm[k]]; }
+
+            void next()
+            {
+                ++k;
+                skip_removed();
+                if (distance != 0 && k + distance < perm.size())
+                    prefetch_item(container.get_items(), perm[k + distance]);
+            }
+        };
+
+        /// @brief Runs the linear merge. take_a / take_b / take_both say whether an element
+        /// that is only in a, only in b, or matched in both goes to the output.
+        template <typename T, typename S1, typename S2>
+        MyContainer<T, S1> sorted_merge(const MyContainer<T, S1> &a, const MyContainer<T, S2> &b,
+                                        bool take_a, bool take_b, bool take_both)
+        {
+            MyContainer<T, S1> out(a.get_resource());
+            size_t bound = take_b ? a.size() + b.size() : take_a ? a.size() : std::min(a.size(), b.size());
+            out.fill_sorted(bound, [&](auto push)
+                            {
+                                SortedCursor<T, S1> x(a);
+                                SortedCursor<T, S2> y(b);
+                                while (!x.done() && !y.done())
+                                {
+                                    if (x.value() < y.value())
+                                    {
+                                        if (take_a)
+                                            push(x.value());
+                                        x.next();
+                                    }
+                                    else if (y.value() < x.value())
+                                    {
+                                        if (take_b)
+                                            push(y.value());
+                                        y.next();
+                                    }
+                                    else
+                                    {
+                                        if (take_both)
+                                            push(x.value());
+                                        x.next();
+                                        y.next();
+                                    }
+                                }
+                                for (; take_a && !x.done(); x.next())
+                                    push(x.value());
+                                for (; take_b && !y.done(); y.next())
+                                    push(y.value()); });
+            return out;
+        }
+    }
+
+    /// @brief All elements of a and b in ascending order (duplicates from both sides kept).
+    template <typename T, typename S1, typename S2>
+    MyContainer<T, S1> merge(const MyContainer<T, S1> &a, const MyContainer<T, S2> &b)
+    {
+        MyContainer<T, S1> out(a.get_resource());
+        out.fill_sorted(a.size() + b.size(), [&](auto push)
+                        {
+                            detail::SortedCursor<T, S1> x(a);
+                            detail::SortedCursor<T, S2> y(b);
+                            while (!x.done() || !y.done())
+                            {
+                                // Ties take from a first, so the merge is stable.
+                                if (y.done() || (!x.done() && !(y.value() < x.value())))
+                                {
+                                    push(x.value());
+                                    x.next();
+                                }
+                                else
+                                {
+                                    push(y.value());
+                                    y.next();
+                                }
+                            } });
+        return out;
+    }
+
+    /// @brief Elements in a or b, in ascending order.
+    template <typename T, typename S1, typename S2>
+    MyContainer<T, S1> set_union(const MyContainer<T, S1> &a, const MyContainer<T, S2> &b)
+    {
+        return detail::sorted_merge(a, b, true, true, true);
+    }
+
+    /// @brief Elements in both a and b, in ascending order.
+    template <typename T, typename S1, typename S2>
+    MyContainer<T, S1> set_intersection(const MyContainer<T, S1> &a, const MyContainer<T, S2> &b)
+    {
+        return detail::sorted_merge(a, b, false, false, true);
+    }
+
+    /// @brief Elements in a that are not in b, in ascending order.
+    template <typename T, typename S1, typename S2>
+    MyContainer<T, S1> set_difference(const MyContainer<T, S1> &a, const MyContainer<T, S2> &b)
+    {
+        return detail::sorted_merge(a, b, true, false, false);
+    }
+
+}
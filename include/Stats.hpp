@@ -0,0 +1,133 @@
+// anksilae@gmail.com
+
+
+/// @brief Always-on instrumentation counters for MyContainer, read through stats().
+/// @details Each counter is a relaxed std::atomic<uint64_t>. Counters bumped by mutations
+/// (adds, removes) have a single writer, since mutating a container is never concurrent, so
+/// they use a relaxed load and store rather than a locked read-modify-write; counters bumped
+/// from const paths that several readers may share (cache hits, invalidations) use fetch_add.
+/// The sorted-index counters are only written while holding the cache's build lock or with
+/// fetch_add, so stats() may run concurrently with const traversals on other threads.
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace containers
+{
+
+    /// @brief A relaxed atomic counter that, unlike std::atomic, copies by value.
+    class StatCounter
+    {
+    private:
+        std::atomic<uint64_t> value{0};
+
+    public:
+        StatCounter() = default;
+        StatCounter(const StatCounter &other) noexcept : value(other.load()) {}
+        StatCounter &operator=(const StatCounter &other) noexcept
+        {
+            value.store(other.load(), std::memory_order_relaxed);
+            return *this;
+        }
+
+        /// @brief Adds n; safe when several threads bump the counter.
+        void increment(uint64_t n = 1) noexcept
+        {
+            value.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        /// @brief Adds n when only one thread ever bumps this counter (no locked instruction).
+        void increment_owned(uint64_t n = 1) noexcept
+        {
+            value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        uint64_t load() const noexcept { return value.load(std::memory_order_relaxed); }
+        void reset() noexcept { value.store(0, std::memory_order_relaxed); }
+    };
+
+    /// @brief A snapshot of a container's counters, as returned by MyContainer::stats().
+    struct ContainerStats
+    {
+        uint64_t adds = 0;              ///< Elements added by add() and append().
+        uint64_t removes = 0;           ///< Elements removed by remove() and remove_if().
+        uint64_t failed_removes = 0;    ///< remove() calls that threw because the value was absent.
+        uint64_t index_builds = 0;      ///< Times the sorted index was (re)built.
+        uint64_t sort_nanoseconds = 0;  ///< Total time spent building the sorted index.
+        uint64_t index_bytes = 0;       ///< Total bytes of positions written by those builds.
+        uint64_t cache_hits = 0;        ///< Sorted-index requests served from the cache.
+        uint64_t cache_misses = 0;      ///< Sorted-index requests that had to rebuild it.
+        uint64_t invalidations = 0;     ///< "Container modified during iteration" errors raised.
+
+        /// @brief Formats the snapshot as a flat JSON object.
+        std::string to_json() const
+        {
+            std::string out = "{";
+            auto field = [&out](const char *name, uint64_t v)
+            {
+                if (out.size() > 1)
+                    out += ",";
+                out += "\"";
+                out += name;
+                out += "\":";
+                out += std::to_string(v);
+            };
+            field("adds", adds);
+            field("removes", removes);
+            field("failed_removes", failed_removes);
+            field("index_builds", index_builds);
+            field("sort_nanoseconds", sort_nanoseconds);
+            field("index_bytes", index_bytes);
+            field("cache_hits", cache_hits);
+            field("cache_misses", cache_misses);
+            field("invalidations", invalidations);
+            return out + "}";
+        }
+    };
+
+    /// @brief Counters bumped on every container (mutations and invalidations), kept in-object.
+    struct MutationCounters
+    {
+        StatCounter adds, removes, failed_removes, invalidations;
+
+        void reset()
+        {
+            for (StatCounter *c : {&adds, &removes, &failed_removes, &invalidations})
+                c->reset();
+        }
+    };
+
+    /// @brief Counters of the sorted-index cache; they live next to the cache, which is only
+    /// allocated once a sorted order is requested.
+    struct IndexCounters
+    {
+        StatCounter index_builds, sort_nanoseconds, index_bytes, cache_hits, cache_misses;
+
+        void reset()
+        {
+            for (StatCounter *c : {&index_builds, &sort_nanoseconds, &index_bytes, &cache_hits, &cache_misses})
+                c->reset();
+        }
+    };
+
+    /// @brief Combines the two counter groups into a snapshot; index may be null (never sorted).
+    inline ContainerStats make_stats(const MutationCounters &mutations, const IndexCounters *index)
+    {
+        ContainerStats stats;
+        stats.adds = mutations.adds.load();
+        stats.removes = mutations.removes.load();
+        stats.failed_removes = mutations.failed_removes.load();
+        stats.invalidations = mutations.invalidations.load();
+        if (index)
+        {
+            stats.index_builds = index->index_builds.load();
+            stats.sort_nanoseconds = index->sort_nanoseconds.load();
+            stats.index_bytes = index->index_bytes.load();
+            stats.cache_hits = index->cache_hits.load();
+            stats.cache_misses = index->cache_misses.load();
+        }
+        return stats;
+    }
+
+}
@@ -0,0 +1,160 @@
+// anksilae@gmail.com
+
+
+/// @brief Generator: a minimal C++20 coroutine generator, used for the lazy versions of the
+/// traversal orders (MyContainer::AscendingGen() and friends).
+/// @details The coroutine runs only when the consumer advances, one element at a time, so an
+/// export can be written out as it is produced instead of being collected into a vector
+/// first. batched() groups a generator's values into spans, suspending after each batch so an
+/// I/O consumer can drain it before the next one is produced.
+#pragma once
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace containers
+{
+
+    template <typename T>
+    class Generator
+    {
+    public:
+        using value_type = std::remove_cvref_t<T>;
+        using reference = const value_type &;
+
+        struct promise_type
+        {
+            const value_type *current = nullptr; ///< The yielded value, alive while suspended.
+            std::exception_ptr error;
+
+            Generator get_return_object()
+            {
+                return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            std::suspend_always yield_value(const value_type &value) noexcept
+            {
+                current = std::addressof(value);
+                return {};
+            }
+            void return_void() noexcept {}
+            void unhandled_exception() { error = std::current_exception(); }
+
+            // Generators only yield; co_await is not supported.
+            template <typename U>
+            std::suspend_never await_transform(U &&) = delete;
+        };
+
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        class Iterator
+        {
+        private:
+            handle_type handle;
+
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using difference_type = std::ptrdiff_t;
+            using value_type = Generator::value_type;
+
+            Iterator() = default;
+            explicit Iterator(handle_type h) : handle(h) {}
+
+            /// @brief Resumes the coroutine up to its next value.
+            /// @throws Whatever the coroutine threw (e.g. a modified-container error).
+            Iterator &operator++()
+            {
+                handle.resume();
+                if (handle.done() && handle.promise().error)
+                    std::rethrow_exception(handle.promise().error);
+                return *this;
+            }
+            void operator++(int) { ++*this; }
+
+            reference operator*() const { return *handle.promise().current; }
+
+            bool operator==(std::default_sentinel_t) const { return !handle || handle.done(); }
+        };
+
+    private:
+        handle_type handle;
+
+        explicit Generator(handle_type h) : handle(h) {}
+
+    public:
+        /// @brief An empty generator that yields nothing.
+        Generator() = default;
+
+        Generator(Generator &&other) noexcept : handle(std::exchange(other.handle, {})) {}
+
+        Generator &operator=(Generator &&other) noexcept
+        {
+            if (this != &other)
+            {
+                if (handle)
+                    handle.destroy();
+                handle = std::exchange(other.handle, {});
+            }
+            return *this;
+        }
+
+        Generator(const Generator &) = delete;
+        Generator &operator=(const Generator &) = delete;
+
+        ~Generator()
+        {
+            if (handle)
+                handle.destroy();
+        }
+
+        /// @brief Starts the coroutine; a generator can be iterated only once.
+        /// @details An empty (default-constructed or moved-from) or finished generator yields
+        /// nothing: begin() == end().
+        Iterator begin()
+        {
+            if (!handle || handle.done())
+                return Iterator(handle);
+            Iterator it(handle);
+            ++it;
+            return it;
+        }
+
+        std::default_sentinel_t end() const { return {}; }
+    };
+
+    /// @brief Regroups a generator's values into spans of up to batch_size elements.
+    /// @details Each span points into a buffer owned by the coroutine and stays valid until
+    /// the consumer advances; the next batch is produced only then, so at most batch_size
+    /// values are ever held in memory.
+    /// @throws std::invalid_argument (when iteration starts) if batch_size is 0.
+    template <typename T>
+    Generator<std::span<const T>> batched(Generator<T> source, size_t batch_size)
+    {
+        if (batch_size == 0)
+        {
+            throw std::invalid_argument("Batch size must be positive");
+        }
+        std::vector<T> buffer;
+        buffer.reserve(batch_size);
+        for (const T &value : source)
+        {
+            buffer.push_back(value);
+            if (buffer.size() == batch_size)
+            {
+                co_yield std::span<const T>(buffer);
+                buffer.clear();
+            }
+        }
+        if (!buffer.empty())
+            co_yield std::span<const T>(buffer);
+    }
+
+}
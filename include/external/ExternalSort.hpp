@@ -0,0 +1,277 @@
+// anksilae@gmail.com
+
+
+/// @brief External-memory sort: ordered traversal of data larger than the memory budget.
+/// @details Values are read in order from a generator (e.g. MyContainer::NormalGen()) or a raw
+/// binary file of T. Each time memory_budget bytes are buffered, the buffer is sorted and
+/// written to a temporary run file. The runs are then streamed back through a k-way merge
+/// (a heap of the runs' current heads), each run read in blocks that together stay within
+/// the budget. Only the merge heap and the block buffers are in memory at any time; streams
+/// are unbuffered, so the only overshoot is the heap (one value per run) and, with more runs
+/// than the budget has values, the one-value minimum block per run. Input that fits in one
+/// buffer is sorted in memory without touching the disk. Run files are created exclusively
+/// (mkstemp), so several sorts may share temp_dir.
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../coro/Generator.hpp"
+#include "../trace/Trace.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <stdlib.h>
+#include <unistd.h>
+#define CONTAINERS_EXTERNAL_MKSTEMP 1
+#endif
+
+namespace containers
+{
+
+    /// @brief Tuning for external_sorted() and external_sorted_file().
+    struct ExternalSortOptions
+    {
+        size_t memory_budget = size_t{256} << 20;        ///< Bytes buffered per run and used by the merge.
+        std::filesystem::path temp_dir = std::filesystem::temp_directory_path(); ///< Where run files go.
+        bool descending = false;                         ///< Largest value first.
+    };
+
+    namespace detail
+    {
+        /// @brief A temporary file of sorted values, deleted when the object goes away.
+        /// @details The file is created exclusively under a unique name, so runs of other sorts
+        /// (in this or another process) sharing the directory are never overwritten.
+        class RunFile
+        {
+        private:
+            std::filesystem::path path;
+
+        public:
+            /// @throws std::runtime_error if no file can be created in dir.
+            explicit RunFile(const std::filesystem::path &dir)
+            {
+#ifdef CONTAINERS_EXTERNAL_MKSTEMP
+                std::string name = (dir / "containers-run-XXXXXX").string();
+                int fd = ::mkstemp(name.data());
+                if (fd < 0)
+                {
+                    throw std::runtime_error("Cannot create a run file in " + dir.string());
+                }
+                ::close(fd);
+                path = name;
+#else
+                // Exclusive create ("x"), retried with a fresh random name if the name is taken.
+                std::random_device entropy;
+                for (int attempt = 0; attempt < 100; ++attempt)
+                {
+                    path = dir / ("containers-run-" + std::to_string(entropy()) + std::to_string(entropy()) + ".bin");
+                    if (std::FILE *file = std::fopen(path.string().c_str(), "wbx"))
+                    {
+                        std::fclose(file);
+                        return;
+                    }
+                    if (errno != EEXIST)
+                        break;
+                }
+                throw std::runtime_error("Cannot create a run file in " + dir.string());
+#endif
+            }
+            RunFile(const RunFile &) = delete;
+            RunFile &operator=(const RunFile &) = delete;
+            ~RunFile()
+            {
+                std::error_code ignored;
+                std::filesystem::remove(path, ignored);
+            }
+            const std::filesystem::path &file() const { return path; }
+        };
+
+        /// @brief Reads a binary file of T block by block.
+        template <typename T>
+        class BlockReader
+        {
+        private:
+            std::ifstream in;
+            std::vector<T> block;
+            size_t pos = 0;
+
+        public:
+            BlockReader(const std::filesystem::path &path, size_t block_values)
+                : block(std::max<size_t>(1, block_values))
+            {
+                // Reads are whole blocks already; a stream buffer per run would only add to the budget.
+                in.rdbuf()->pubsetbuf(nullptr, 0);
+                in.open(path, std::ios::binary);
+                if (!in)
+                {
+                    throw std::runtime_error("Cannot open " + path.string());
+                }
+                block.clear();
+            }
+
+            /// @brief Returns false at end of file; otherwise stores the next value in out.
+            bool next(T &out)
+            {
+                if (pos == block.size())
+                {
+                    block.resize(block.capacity());
+                    in.read(reinterpret_cast<char *>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(T)));
+                    size_t bytes = static_cast<size_t>(in.gcount());
+                    if (in.bad())
+                    {
+                        throw std::runtime_error("Read error in external sort");
+                    }
+                    if (bytes % sizeof(T) != 0)
+                    {
+                        throw std::runtime_error("Truncated run file in external sort");
+                    }
+                    size_t got = bytes / sizeof(T);
+                    block.resize(got);
+                    pos = 0;
+                    if (got == 0)
+                        return false;
+                }
+                out = block[pos++];
+                return true;
+            }
+        };
+
+        template <typename T, typename Less>
+        void write_run(std::vector<T> &buffer, Less less, std::vector<std::unique_ptr<RunFile>> &runs,
+                       const std::filesystem::path &dir)
+        {
+            CONTAINERS_TRACE_SCOPE("external_sort.write_run", buffer.size());
+            std::sort(buffer.begin(), buffer.end(), less);
+            runs.push_back(std::make_unique<RunFile>(dir));
+            std::ofstream out(runs.back()->file(), std::ios::binary);
+            out.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(T)));
+            out.close(); // flushes, so a full disk is reported here rather than lost in the destructor
+            if (!out)
+            {
+                throw std::runtime_error("Write error in external sort (disk full?)");
+            }
+            buffer.clear();
+        }
+
+        /// @brief Appends value, growing the buffer to exactly max_values rather than past it.
+        template <typename T>
+        void append_bounded(std::vector<T> &buffer, const T &value, size_t max_values)
+        {
+            if (buffer.size() == buffer.capacity() && buffer.size() * 2 > max_values)
+                buffer.reserve(max_values);
+            buffer.push_back(value);
+        }
+
+        template <typename T, typename Less>
+        Generator<T> merge_runs(std::vector<T> buffer, std::vector<std::unique_ptr<RunFile>> runs,
+                                ExternalSortOptions options, Less less)
+        {
+            if (runs.empty())
+            {
+                {
+                    CONTAINERS_TRACE_SCOPE("external_sort.sort", buffer.size());
+                    std::sort(buffer.begin(), buffer.end(), less);
+                }
+                for (const T &value : buffer)
+                    co_yield value;
+                co_return;
+            }
+            if (!buffer.empty())
+                write_run(buffer, less, runs, options.temp_dir);
+            std::vector<T>().swap(buffer);
+
+            size_t block_values = options.memory_budget / sizeof(T) / (runs.size() + 1);
+            std::vector<BlockReader<T>> readers;
+            readers.reserve(runs.size());
+            for (const auto &run : runs)
+                readers.emplace_back(run->file(), block_values);
+
+            // Min-heap (by less) of (head value, run).
+            auto greater = [&less](const std::pair<T, size_t> &a, const std::pair<T, size_t> &b)
+            { return less(b.first, a.first); };
+            std::priority_queue<std::pair<T, size_t>, std::vector<std::pair<T, size_t>>, decltype(greater)> heads(greater);
+            T value;
+            for (size_t r = 0; r < readers.size(); ++r)
+                if (readers[r].next(value))
+                    heads.emplace(value, r);
+            while (!heads.empty())
+            {
+                auto [head, r] = heads.top();
+                heads.pop();
+                co_yield head;
+                if (readers[r].next(value))
+                    heads.emplace(value, r);
+            }
+        }
+
+        template <typename T>
+        void check_budget(const ExternalSortOptions &options)
+        {
+            if (options.memory_budget < 2 * sizeof(T))
+            {
+                throw std::invalid_argument("Memory budget too small for external sort");
+            }
+        }
+    }
+
+    /// @brief Yields the values of source in sorted order using at most about
+    /// options.memory_budget bytes of memory; the rest is spilled to temporary files.
+    /// @details Temporary files are removed when the generator is destroyed.
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    Generator<T> external_sorted(Generator<T> source, ExternalSortOptions options = {})
+    {
+        detail::check_budget<T>(options);
+        size_t run_values = options.memory_budget / sizeof(T);
+        std::vector<T> buffer;
+        std::vector<std::unique_ptr<detail::RunFile>> runs;
+        auto less = [descending = options.descending](const T &a, const T &b)
+        { return descending ? b < a : a < b; };
+        for (const T &value : source)
+        {
+            detail::append_bounded(buffer, value, run_values);
+            if (buffer.size() == run_values)
+                detail::write_run(buffer, less, runs, options.temp_dir);
+        }
+        return detail::merge_runs(std::move(buffer), std::move(runs), std::move(options), less);
+    }
+
+    /// @brief Yields the values stored in a raw binary file of T in sorted order (see above).
+    /// @throws std::runtime_error if the file cannot be read.
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    Generator<T> external_sorted_file(const std::filesystem::path &path, ExternalSortOptions options = {})
+    {
+        detail::check_budget<T>(options);
+        // The input block and the run buffer share the budget.
+        size_t budget_values = options.memory_budget / sizeof(T);
+        size_t read_values = std::max<size_t>(1, std::min<size_t>(budget_values / 16, size_t{1} << 16));
+        size_t run_values = budget_values - read_values;
+        detail::BlockReader<T> reader(path, read_values);
+        std::vector<T> buffer;
+        std::vector<std::unique_ptr<detail::RunFile>> runs;
+        auto less = [descending = options.descending](const T &a, const T &b)
+        { return descending ? b < a : a < b; };
+        T value;
+        while (reader.next(value))
+        {
+            detail::append_bounded(buffer, value, run_values);
+            if (buffer.size() == run_values)
+                detail::write_run(buffer, less, runs, options.temp_dir);
+        }
+        return detail::merge_runs(std::move(buffer), std::move(runs), std::move(options), less);
+    }
+
+}
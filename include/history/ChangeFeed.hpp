@@ -0,0 +1,94 @@
+// anksilae@gmail.com
+
+
+/// @brief ChangeFeed: add/remove events of a MyContainer, for incremental consumers.
+/// @details Consumers either poll MyContainer::changes_since(v) (read from the version
+/// history) or subscribe a callback that sees every change as it happens.
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "VersionHistory.hpp"
+
+namespace containers
+{
+
+    /// @brief One element added to or removed from a container.
+    template <typename T>
+    struct Change
+    {
+        enum class Kind
+        {
+            Added,
+            Removed
+        };
+
+        size_t version;  ///< The version the change produced.
+        Kind kind;
+        size_t position; ///< Insertion-order index: after the change for Added, before it for Removed.
+        T value;
+    };
+
+    /// @brief Flattens a history delta into its changes, removals first.
+    template <typename T, typename F>
+    void for_each_change(const typename VersionHistory<T>::Delta &delta, F &&f)
+    {
+        for (const auto &[pos, value] : delta.removed)
+            f(Change<T>{delta.version, Change<T>::Kind::Removed, pos, value});
+        for (size_t k = 0; k < delta.appended.size(); ++k)
+            f(Change<T>{delta.version, Change<T>::Kind::Added, delta.first_appended + k, delta.appended[k]});
+    }
+
+    /// @brief Registry of change callbacks. Copies of a container start without subscribers.
+    template <typename T>
+    class ChangeFeed
+    {
+    public:
+        using Callback = std::function<void(const Change<T> &)>;
+
+    private:
+        std::vector<std::pair<size_t, Callback>> subscribers;
+        size_t next_id = 1;
+
+    public:
+        ChangeFeed() = default;
+        ChangeFeed(const ChangeFeed &) {}
+        ChangeFeed(ChangeFeed &&) = default;
+        ChangeFeed &operator=(const ChangeFeed &) { return *this; }
+        ChangeFeed &operator=(ChangeFeed &&) = default;
+
+        /// @brief Registers callback and returns the id to unsubscribe with.
+        size_t subscribe(Callback callback)
+        {
+            subscribers.emplace_back(next_id, std::move(callback));
+            return next_id++;
+        }
+
+        /// @brief Removes a subscription; returns false if the id is unknown.
+        bool unsubscribe(size_t id)
+        {
+            for (auto it = subscribers.begin(); it != subscribers.end(); ++it)
+            {
+                if (it->first == id)
+                {
+                    subscribers.erase(it);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool active() const { return !subscribers.empty(); }
+
+        /// @brief Delivers every change of delta to every subscriber.
+        void notify(const typename VersionHistory<T>::Delta &delta) const
+        {
+            for_each_change<T>(delta, [this](const Change<T> &change)
+                               {
+                                   for (const auto &subscriber : subscribers)
+                                       subscriber.second(change); });
+        }
+    };
+
+}
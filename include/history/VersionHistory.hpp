@@ -0,0 +1,140 @@
+// anksilae@gmail.com
+
+
+/// @brief VersionHistory: bounded log of what each MyContainer version changed.
+/// @details One Delta per version bump, holding the values removed (with their positions
+/// before the removal) and the values appended. Undoing the deltas newer than v from the
+/// current contents rebuilds the container as of v, so old versions cost memory proportional
+/// to the changes since then instead of a full copy per checkpoint.
+#pragma once
+#include <cstddef>
+#include <algorithm>
+#include <memory_resource>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace containers
+{
+
+    template <typename T>
+    class VersionHistory
+    {
+    public:
+        /// @brief Changes made by the bump to one version. Removals apply before appends.
+        struct Delta
+        {
+            size_t version;                              ///< The version this change produced.
+            size_t first_appended;                       ///< Position of appended[0] after the change.
+            std::pmr::vector<T> appended;                ///< Values appended at the end.
+            std::pmr::vector<std::pair<size_t, T>> removed; ///< (position before the change, value), ascending.
+        };
+
+    private:
+        // Ring buffer: once full, head is the oldest delta and begin() overwrites it. A vector
+        // (unlike std::deque) allocates nothing until history is actually used.
+        std::pmr::vector<Delta> ring;
+        size_t head = 0;
+        size_t limit = 0; ///< Versions kept; 0 = history disabled.
+
+        Delta &at(size_t k) { return ring[(head + k) % ring.size()]; }
+
+    public:
+        explicit VersionHistory(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+            : ring(resource) {}
+
+        /// @brief Starts (or resizes) the log, keeping at most max_versions deltas.
+        void enable(size_t max_versions)
+        {
+            if (max_versions == 0)
+            {
+                throw std::invalid_argument("History must keep at least one version");
+            }
+            if (limit == 0)
+                ring.clear(); // a delta kept only for the change feed may leave a gap
+            std::pmr::vector<Delta> kept(ring.get_allocator());
+            size_t drop = ring.size() > max_versions ? ring.size() - max_versions : 0;
+            kept.reserve(ring.size() - drop);
+            for (size_t k = drop; k < ring.size(); ++k)
+                kept.push_back(std::move(at(k)));
+            ring.swap(kept);
+            head = 0;
+            limit = max_versions;
+        }
+
+        /// @brief Stops logging and drops all deltas.
+        void disable()
+        {
+            limit = 0;
+            head = 0;
+            ring.clear();
+        }
+
+        bool enabled() const { return limit != 0; }
+
+        /// @brief Starts the delta for a new version; the caller fills it in.
+        /// @details While disabled only this newest delta is kept, for the change feed.
+        Delta &begin(size_t version)
+        {
+            if (limit == 0)
+                ring.clear();
+            auto *resource = ring.get_allocator().resource();
+            Delta fresh{version, 0, std::pmr::vector<T>(resource), std::pmr::vector<std::pair<size_t, T>>(resource)};
+            if (ring.size() < std::max<size_t>(limit, 1))
+            {
+                ring.push_back(std::move(fresh));
+                return ring.back();
+            }
+            Delta &slot = ring[head];
+            slot = std::move(fresh);
+            head = (head + 1) % ring.size();
+            return slot;
+        }
+
+        /// @brief Number of deltas in the log.
+        size_t size() const { return ring.size(); }
+
+        /// @brief The k-th delta, oldest first.
+        const Delta &operator[](size_t k) const { return ring[(head + k) % ring.size()]; }
+
+        /// @brief True if every delta between v and current is still in the log.
+        bool covers(size_t v, size_t current) const
+        {
+            if (v == current)
+                return true;
+            return enabled() && v < current && !ring.empty() && (*this)[0].version <= v + 1 &&
+                   (*this)[ring.size() - 1].version == current;
+        }
+
+        /// @brief Oldest version that can still be reconstructed.
+        size_t oldest(size_t current) const
+        {
+            return !enabled() || ring.empty() ? current : (*this)[0].version - 1;
+        }
+
+        /// @brief Undoes, on state, every delta newer than v (newest first).
+        void rewind(std::vector<T> &state, size_t v) const
+        {
+            for (size_t k = ring.size(); k > 0 && (*this)[k - 1].version > v; --k)
+            {
+                const Delta *it = &(*this)[k - 1];
+                state.erase(state.end() - static_cast<std::ptrdiff_t>(it->appended.size()), state.end());
+                if (it->removed.empty())
+                    continue;
+                std::vector<T> before;
+                before.reserve(state.size() + it->removed.size());
+                size_t src = 0;
+                for (const auto &[pos, value] : it->removed)
+                {
+                    while (before.size() < pos)
+                        before.push_back(std::move(state[src++]));
+                    before.push_back(value);
+                }
+                while (src < state.size())
+                    before.push_back(std::move(state[src++]));
+                state.swap(before);
+            }
+        }
+    };
+
+}
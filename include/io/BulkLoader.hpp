@@ -0,0 +1,214 @@
+// anksilae@gmail.com
+
+
+/// @brief BulkLoader: fills a numeric MyContainer from whitespace-separated text.
+/// @details Files are memory-mapped (or read whole where mmap is unavailable); streams are
+/// read in large blocks. The text is cut into one chunk per thread at whitespace boundaries,
+/// each thread parses its chunk with std::from_chars into a local vector, and the vectors are
+/// appended in order as one version bump (after an exact reserve() for a mapped file).
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#include "../MyContainer.hpp"
+#include "../Parallel.hpp"
+#include "../trace/Trace.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CONTAINERS_HAVE_MMAP 1
+#endif
+
+namespace containers
+{
+
+    /// @brief Tuning for load_text().
+    struct LoadOptions
+    {
+        size_t threads = 0;                     ///< Parser threads; 0 = hardware concurrency.
+        size_t block_size = size_t{64} << 20;   ///< Bytes read per block from a stream.
+    };
+
+    namespace detail
+    {
+        inline bool is_space(char ch)
+        {
+            return ch == ' ' || ch == '\n' || ch == '\t' || ch == '\r' || ch == '\v' || ch == '\f';
+        }
+
+        /// @brief Parses every whitespace-separated number in text and appends it to out.
+        /// @throws std::invalid_argument on a token that is not a number of type T.
+        template <typename T>
+        void parse_numbers(std::string_view text, std::vector<T> &out)
+        {
+            const char *p = text.data();
+            const char *end = p + text.size();
+            while (true)
+            {
+                while (p != end && is_space(*p))
+                    ++p;
+                if (p == end)
+                    return;
+                const char *token = p;
+                while (p != end && !is_space(*p))
+                    ++p;
+                T value{};
+                // from_chars rejects a leading '+', which text files commonly have.
+                const char *digits = (*token == '+' && p - token > 1) ? token + 1 : token;
+                auto [stop, error] = std::from_chars(digits, p, value);
+                if (error != std::errc() || stop != p)
+                {
+                    throw std::invalid_argument("Invalid number '" + std::string(token, p) + "'");
+                }
+                out.push_back(value);
+            }
+        }
+
+        /// @brief Parses text on several threads and appends the numbers to c in order.
+        template <typename T, typename Storage>
+        size_t load_chunk(MyContainer<T, Storage> &c, std::string_view text, size_t threads, bool last_chunk)
+        {
+            CONTAINERS_TRACE_SCOPE("load_text.chunk", text.size());
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            // Parsing is cheap per byte; a thread only pays off for a sizeable chunk.
+            threads = std::max<size_t>(1, std::min(threads, text.size() / (size_t{1} << 20)));
+
+            std::vector<size_t> cuts = {0};
+            for (size_t t = 1; t < threads; ++t)
+            {
+                size_t cut = std::max(cuts.back(), text.size() * t / threads);
+                while (cut < text.size() && !is_space(text[cut]))
+                    ++cut;
+                cuts.push_back(cut);
+            }
+            cuts.push_back(text.size());
+
+            std::vector<std::vector<T>> parsed(threads);
+            parallel_chunks(threads, 1, [&](size_t begin, size_t end)
+                            {
+                                for (size_t t = begin; t < end; ++t)
+                                {
+                                    std::string_view part = text.substr(cuts[t], cuts[t + 1] - cuts[t]);
+                                    parsed[t].reserve(part.size() / 4);
+                                    parse_numbers(part, parsed[t]);
+                                } }, threads);
+
+            size_t total = 0;
+            std::vector<std::span<const T>> parts(parsed.begin(), parsed.end());
+            for (std::span<const T> part : parts)
+                total += part.size();
+            // append() grows geometrically across stream blocks; the final (or only) chunk
+            // knows the total, so it reserves exactly.
+            if (last_chunk)
+                c.reserve(c.size() + total);
+            c.append(parts);
+            return total;
+        }
+    }
+
+    /// @brief Appends every number in a whitespace-separated text stream (e.g. std::cin).
+    /// @details Reads options.block_size bytes at a time; a token cut by the block end is
+    /// carried over to the next block. Each block is one append (one version bump).
+    /// @return The number of values added.
+    /// @throws std::invalid_argument on a token that is not a number of type T.
+    template <typename T, typename Storage>
+        requires std::is_arithmetic_v<T>
+    size_t load_text(MyContainer<T, Storage> &c, std::istream &in, LoadOptions options = {})
+    {
+        std::string block;
+        size_t carried = 0, loaded = 0;
+        size_t block_size = std::max<size_t>(options.block_size, 64);
+        while (in)
+        {
+            block.resize(carried + block_size);
+            in.read(block.data() + carried, static_cast<std::streamsize>(block_size));
+            size_t filled = carried + static_cast<size_t>(in.gcount());
+            block.resize(filled);
+            // Keep the unfinished last token for the next block.
+            size_t cut = filled;
+            if (in)
+                while (cut > 0 && !detail::is_space(block[cut - 1]))
+                    --cut;
+            loaded += detail::load_chunk(c, std::string_view(block).substr(0, cut), options.threads, !in);
+            block.erase(0, cut);
+            carried = block.size();
+        }
+        if (in.bad())
+        {
+            throw std::runtime_error("Read error while loading text");
+        }
+        return loaded;
+    }
+
+    /// @brief Appends every number in a whitespace-separated text file.
+    /// @details The file is memory-mapped where supported and parsed in one parallel pass.
+    /// @return The number of values added.
+    /// @throws std::runtime_error if the file cannot be opened or mapped.
+    /// @throws std::invalid_argument on a token that is not a number of type T.
+    template <typename T, typename Storage>
+        requires std::is_arithmetic_v<T>
+    size_t load_text(MyContainer<T, Storage> &c, const std::filesystem::path &path, LoadOptions options = {})
+    {
+#ifdef CONTAINERS_HAVE_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Cannot open " + path.string());
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat " + path.string());
+        }
+        size_t length = static_cast<size_t>(info.st_size);
+        if (length == 0)
+        {
+            ::close(fd);
+            return 0;
+        }
+        void *mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            throw std::runtime_error("Cannot map " + path.string());
+        }
+        ::madvise(mapped, length, MADV_SEQUENTIAL);
+        try
+        {
+            size_t loaded = detail::load_chunk(c, std::string_view(static_cast<const char *>(mapped), length),
+                                               options.threads, true);
+            ::munmap(mapped, length);
+            return loaded;
+        }
+        catch (...)
+        {
+            ::munmap(mapped, length);
+            throw;
+        }
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            throw std::runtime_error("Cannot open " + path.string());
+        }
+        options.block_size = std::max<size_t>(options.block_size, std::filesystem::file_size(path) + 1);
+        return load_text(c, in, options);
+#endif
+    }
+
+}
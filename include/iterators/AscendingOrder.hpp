@@ -4,59 +4,68 @@
 
 #pragma once
 #include <vector>
+#include <memory_resource>
 #include <algorithm>
 #include <stdexcept>
-
-namespace containers
-{
-    template <typename T>
-    class MyContainer;
-}
+#include "IndexPermutation.hpp"
+#include "Prefetch.hpp"
+#include "../ContainerFwd.hpp"
 
 namespace containers
 {
 
-    template <typename T>
+    template <typename T, typename Storage = default_storage_t<T>>
     class AscendingOrder
     {
     private:
-        const MyContainer<T> &container; ///< Reference to the container being iterated.
+        const MyContainer<T, Storage> &container; ///< Reference to the container being iterated.
 
     public:
         /// @brief Constructs the AscendingOrder wrapper around the container.
-        AscendingOrder(const MyContainer<T> &cont) : container(cont) {}
+        AscendingOrder(const MyContainer<T, Storage> &cont) : container(cont) {}
 
         class Iterator
         {
         private:
-            const MyContainer<T> &container;
-            std::vector<size_t> indices;      ///< Indices of elements in sorted ascending order.
+            const MyContainer<T, Storage> &container;
+            SortedView sorted;                ///< The ascending permutation: the container's cache, or inline when small.
             size_t current;                   ///< Current position in the sorted indices vector.
             size_t expected_version;          ///< Snapshot of container version to detect modifications.
+            size_t distance;                  ///< Prefetch distance in steps (0 = off).
+
+            const IndexPermutation &indices() const
+            {
+                return sorted.get();
+            }
+
+            /// @brief Skips permutation slots whose element is a pending tombstone.
+            size_t skip_removed(size_t k) const
+            {
+                while (k < indices().size() && !container.is_live(indices()[k]))
+                    ++k;
+                return k;
+            }
+
+            /// @brief Prefetches the element `distance` slots ahead of the current one.
+            void prefetch_ahead() const
+            {
+                if (distance != 0 && current + distance < indices().size())
+                    prefetch_item(container.get_items(), indices()[current + distance]);
+            }
 
         public:
-            /// @brief Initializes iterator and builds sorted index map.
+            /// @brief Initializes the iterator over the container's sorted permutation.
+            /// @details The permutation is built on first use and shared by every later
+            /// iterator until an element is added or moved; containers of up to
+            /// IndexPermutation::inline_positions elements are sorted inside the iterator instead.
             /// @param is_end If true, positions the iterator at end.
-            Iterator(const MyContainer<T> &cont, bool is_end = false)
-                : container(cont), current(0), expected_version(cont.get_version())
+            Iterator(const MyContainer<T, Storage> &cont, bool is_end = false)
+                : container(cont), sorted(cont), current(0),
+                  expected_version(cont.get_version()), distance(prefetch_distance())
             {
-                const auto &items = container.get_items();
-                size_t n = items.size();
-                indices.resize(n);
-                for (size_t i = 0; i < n; ++i)
-                    indices[i] = i;
-
-                // Sort indices by comparing container values
-                std::sort(indices.begin(), indices.end(),
-                          [&](size_t a, size_t b)
-                          {
-                              return items[a] < items[b];
-                          });
-
-                if (is_end)
-                {
-                    current = n;
-                }
+                current = is_end ? indices().size() : skip_removed(0);
+                for (size_t k = current; !is_end && k < std::min(current + distance, indices().size()); ++k)
+                    prefetch_item(container.get_items(), indices()[k]);
             }
 
             /// @brief Dereferences the iterator to return the current element.
@@ -66,13 +75,13 @@ namespace containers
             {
                 if (expected_version != container.get_version())
                 {
-                    throw std::runtime_error("Container modified during iteration");
+                    container.throw_modified();
                 }
-                if (current >= indices.size())
+                if (current >= indices().size())
                 {
                     throw std::out_of_range("Iterator out of bounds");
                 }
-                return container.get_items()[indices[current]];
+                return container.get_items()[indices()[current]];
             }
 
             /// @brief Moves the iterator to the next element.
@@ -82,13 +91,14 @@ namespace containers
             {
                 if (expected_version != container.get_version())
                 {
-                    throw std::runtime_error("Container modified during iteration");
+                    container.throw_modified();
                 }
-                if (current >= indices.size())
+                if (current >= indices().size())
                 {
                     throw std::out_of_range("Iterator out of bounds");
                 }
-                ++current;
+                current = skip_removed(current + 1);
+                prefetch_ahead();
                 return *this;
             }
 
@@ -0,0 +1,80 @@
+// anksilae@gmail.com
+
+
+/// @brief BlockCache: lets the sequential iterators read block-compressed storage (PackedStorage)
+/// one decoded block at a time instead of decoding every element on its own.
+/// @details The decoded block lives once in the range object (NormalOrder, ReverseOrder);
+/// iterators keep only a BlockCacheRef to it, so copying an iterator copies a pointer, not a
+/// block. The block is tagged with the container version it was decoded at, so a range that is
+/// traversed again after the container changed decodes afresh. For every other storage both
+/// are empty pass-throughs to items[pos].
+#pragma once
+#include <array>
+#include <cstddef>
+#include "../ContainerFwd.hpp"
+
+namespace containers
+{
+
+    /// @brief Storage that can decode a whole block of elements at once.
+    template <typename S>
+    concept block_storage = requires(const S &s, typename S::value_type *out) {
+        { S::block_size } -> std::convertible_to<size_t>;
+        { s.decode_block(size_t{}, out) } -> std::convertible_to<size_t>;
+    };
+
+    template <typename T, typename Storage>
+    struct BlockCache
+    {
+        T get(const Storage &items, size_t pos, size_t) const { return items[pos]; }
+        void reset() const {}
+    };
+
+    template <typename T, block_storage Storage>
+    struct BlockCache<T, Storage>
+    {
+        mutable std::array<T, Storage::block_size> values{};
+        mutable size_t block = static_cast<size_t>(-1);
+        mutable size_t version = 0; ///< Container version the block was decoded at.
+
+        /// @brief Returns items[pos] at container version v, decoding its block first if it is
+        /// not the cached one or was decoded at another version.
+        T get(const Storage &items, size_t pos, size_t v) const
+        {
+            size_t b = pos / Storage::block_size;
+            if (b != block || v != version)
+            {
+                items.decode_block(b, values.data());
+                block = b;
+                version = v;
+            }
+            return values[pos % Storage::block_size];
+        }
+
+        /// @brief Forgets the decoded block, e.g. when a new traversal starts (an assigned-to
+        /// container can repeat a version number).
+        void reset() const { block = static_cast<size_t>(-1); }
+    };
+
+    /// @brief An iterator's handle to its range's BlockCache; empty unless Storage is block_storage.
+    template <typename T, typename Storage>
+    struct BlockCacheRef
+    {
+        explicit BlockCacheRef(const BlockCache<T, Storage> * = nullptr) {}
+        T get(const Storage &items, size_t pos, size_t) const { return items[pos]; }
+    };
+
+    template <typename T, block_storage Storage>
+    struct BlockCacheRef<T, Storage>
+    {
+        const BlockCache<T, Storage> *cache; ///< nullptr: decode single elements (no range to share).
+
+        explicit BlockCacheRef(const BlockCache<T, Storage> *shared = nullptr) : cache(shared) {}
+
+        T get(const Storage &items, size_t pos, size_t version) const
+        {
+            return cache ? cache->get(items, pos, version) : items[pos];
+        }
+    };
+
+}
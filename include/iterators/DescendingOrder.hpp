@@ -5,57 +5,70 @@
 /// @details For example, on [7, 15, 6, 1, 2], the order is: 15, 7, 6, 2, 1.
 #pragma once
 #include <vector>
+#include <memory_resource>
 #include <algorithm>
 #include <stdexcept>
+#include "IndexPermutation.hpp"
+#include "Prefetch.hpp"
+#include "../ContainerFwd.hpp"
 
 namespace containers
 {
-    template <typename T>
-    class MyContainer;
-}
 
-namespace containers
-{
-
-    template <typename T>
+    template <typename T, typename Storage = default_storage_t<T>>
     class DescendingOrder
     {
     private:
-        const MyContainer<T> &container;
+        const MyContainer<T, Storage> &container;
 
     public:
-        DescendingOrder(const MyContainer<T> &cont) : container(cont) {}
+        DescendingOrder(const MyContainer<T, Storage> &cont) : container(cont) {}
 
         class Iterator
         {
         private:
-            const MyContainer<T> &container;
-            std::vector<size_t> indices;
+            const MyContainer<T, Storage> &container;
+            SortedView sorted;                ///< The ascending permutation, walked from the back: the container's cache, or inline when small.
             size_t current;
             size_t expected_version;
+            size_t distance; ///< Prefetch distance in steps (0 = off).
+
+            const IndexPermutation &indices() const
+            {
+                return sorted.get();
+            }
+
+            /// @brief Slot of the permutation visited at step k.
+            size_t slot(size_t k) const
+            {
+                return indices().size() - 1 - k;
+            }
+
+            /// @brief Skips steps whose element is a pending tombstone.
+            size_t skip_removed(size_t k) const
+            {
+                while (k < indices().size() && !container.is_live(indices()[slot(k)]))
+                    ++k;
+                return k;
+            }
+
+            /// @brief Prefetches the element `distance` steps ahead of the current one.
+            void prefetch_ahead() const
+            {
+                if (distance != 0 && current + distance < indices().size())
+                    prefetch_item(container.get_items(), indices()[slot(current + distance)]);
+            }
 
         public:
-            /// @brief Initializes the iterator.
+            /// @brief Initializes the iterator over the container's sorted permutation.
             /// @param is_end Whether the iterator points to end.
-            Iterator(const MyContainer<T> &cont, bool is_end = false)
-                : container(cont), current(0), expected_version(cont.get_version())
+            Iterator(const MyContainer<T, Storage> &cont, bool is_end = false)
+                : container(cont), sorted(cont), current(0),
+                  expected_version(cont.get_version()), distance(prefetch_distance())
             {
-                const auto &items = container.get_items();
-                size_t n = items.size();
-                indices.resize(n);
-                for (size_t i = 0; i < n; ++i)
-                    indices[i] = i;
-
-                std::sort(indices.begin(), indices.end(),
-                          [&](size_t a, size_t b)
-                          {
-                              return items[a] > items[b];
-                          });
-
-                if (is_end)
-                {
-                    current = n;
-                }
+                current = is_end ? indices().size() : skip_removed(0);
+                for (size_t k = current; !is_end && k < std::min(current + distance, indices().size()); ++k)
+                    prefetch_item(container.get_items(), indices()[slot(k)]);
             }
 
             /// @brief Dereferences the iterator to get the current value.
@@ -65,13 +78,13 @@ namespace containers
             {
                 if (expected_version != container.get_version())
                 {
-                    throw std::runtime_error("Container modified during iteration");
+                    container.throw_modified();
                 }
-                if (current >= indices.size())
+                if (current >= indices().size())
                 {
                     throw std::out_of_range("Iterator out of bounds");
                 }
-                return container.get_items()[indices[current]];
+                return container.get_items()[indices()[slot(current)]];
             }
 
             /// @brief Advances to the next element.
@@ -81,13 +94,14 @@ namespace containers
             {
                 if (expected_version != container.get_version())
                 {
-                    throw std::runtime_error("Container modified during iteration");
+                    container.throw_modified();
                 }
-                 if(current >= indices.size())
+                 if(current >= indices().size())
                 {
                     throw std::out_of_range("Iterator out of bounds");
                 }
-                ++current;
+                current = skip_removed(current + 1);
+                prefetch_ahead();
                 return *this;
             }
 
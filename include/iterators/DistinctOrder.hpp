@@ -0,0 +1,95 @@
+// anksilae@gmail.com
+
+
+/// @brief DistinctOrder iterator: each distinct value once, from smallest to largest.
+/// @details For example, on [7, 1, 7, 2, 1], the order is: 1, 2, 7.
+#pragma once
+#include <stdexcept>
+#include "SortedRuns.hpp"
+#include "../ContainerFwd.hpp"
+
+namespace containers
+{
+
+    template <typename T, typename Storage = default_storage_t<T>>
+    class DistinctOrder
+    {
+    private:
+        const MyContainer<T, Storage> &container;
+
+    public:
+        DistinctOrder(const MyContainer<T, Storage> &cont) : container(cont) {}
+
+        class Iterator
+        {
+        private:
+            const MyContainer<T, Storage> &container;
+            SortedRuns<T, Storage> runs; ///< Runs of equal values in the cached sorted permutation.
+            size_t expected_version;
+
+        public:
+            /// @brief Initializes the iterator.
+            /// @param is_end Whether the iterator points to end.
+            Iterator(const MyContainer<T, Storage> &cont, bool is_end = false)
+                : container(cont), runs(cont, is_end), expected_version(cont.get_version()) {}
+
+            /// @brief Dereferences the iterator to get the current value.
+            /// @throws std::runtime_error if modified during iteration.
+            /// @throws std::out_of_range if out of bounds.
+            T operator*() const
+            {
+                if (expected_version != container.get_version())
+                {
+                    container.throw_modified();
+                }
+                if (runs.done())
+                {
+                    throw std::out_of_range("Iterator out of bounds");
+                }
+                return runs.value();
+            }
+
+            /// @brief Advances past every copy of the current value.
+            /// @throws std::runtime_error if modified during iteration.
+            /// @throws std::out_of_range if out of bounds.
+            Iterator &operator++()
+            {
+                if (expected_version != container.get_version())
+                {
+                    container.throw_modified();
+                }
+                if (runs.done())
+                {
+                    throw std::out_of_range("Iterator out of bounds");
+                }
+                runs.next();
+                return *this;
+            }
+
+            /// @brief Checks inequality between two iterators.
+            bool operator!=(const Iterator &other) const
+            {
+                return runs.slot() != other.runs.slot();
+            }
+
+            /// @brief Checks equality between two iterators.
+            bool operator==(const Iterator &other) const
+            {
+                return runs.slot() == other.runs.slot();
+            }
+        };
+
+        /// @brief Returns iterator to beginning.
+        Iterator begin() const
+        {
+            return Iterator(container, false);
+        }
+
+        /// @brief Returns iterator to end.
+        Iterator end() const
+        {
+            return Iterator(container, true);
+        }
+    };
+
+}
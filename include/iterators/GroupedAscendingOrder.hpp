@@ -0,0 +1,96 @@
+// anksilae@gmail.com
+
+
+/// @brief GroupedAscendingOrder iterator: (value, count) pairs, from smallest value to largest.
+/// @details For example, on [7, 1, 7, 2, 1], the order is: (1, 2), (2, 1), (7, 2).
+#pragma once
+#include <stdexcept>
+#include <utility>
+#include "SortedRuns.hpp"
+#include "../ContainerFwd.hpp"
+
+namespace containers
+{
+
+    template <typename T, typename Storage = default_storage_t<T>>
+    class GroupedAscendingOrder
+    {
+    private:
+        const MyContainer<T, Storage> &container;
+
+    public:
+        GroupedAscendingOrder(const MyContainer<T, Storage> &cont) : container(cont) {}
+
+        class Iterator
+        {
+        private:
+            const MyContainer<T, Storage> &container;
+            SortedRuns<T, Storage> runs; ///< Runs of equal values in the cached sorted permutation.
+            size_t expected_version;
+
+        public:
+            /// @brief Initializes the iterator.
+            /// @param is_end Whether the iterator points to end.
+            Iterator(const MyContainer<T, Storage> &cont, bool is_end = false)
+                : container(cont), runs(cont, is_end), expected_version(cont.get_version()) {}
+
+            /// @brief Returns the current value and how many elements are equal to it.
+            /// @throws std::runtime_error if modified during iteration.
+            /// @throws std::out_of_range if out of bounds.
+            std::pair<T, size_t> operator*() const
+            {
+                if (expected_version != container.get_version())
+                {
+                    container.throw_modified();
+                }
+                if (runs.done())
+                {
+                    throw std::out_of_range("Iterator out of bounds");
+                }
+                return {runs.value(), runs.count()};
+            }
+
+            /// @brief Advances past every copy of the current value.
+            /// @throws std::runtime_error if modified during iteration.
+            /// @throws std::out_of_range if out of bounds.
+            Iterator &operator++()
+            {
+                if (expected_version != container.get_version())
+                {
+                    container.throw_modified();
+                }
+                if (runs.done())
+                {
+                    throw std::out_of_range("Iterator out of bounds");
+                }
+                runs.next();
+                return *this;
+            }
+
+            /// @brief Checks inequality between two iterators.
+            bool operator!=(const Iterator &other) const
+            {
+                return runs.slot() != other.runs.slot();
+            }
+
+            /// @brief Checks equality between two iterators.
+            bool operator==(const Iterator &other) const
+            {
+                return runs.slot() == other.runs.slot();
+            }
+        };
+
+        /// @brief Returns iterator to beginning.
+        Iterator begin() const
+        {
+            return Iterator(container, false);
+        }
+
+        /// @brief Returns iterator to end.
+        Iterator end() const
+        {
+            return Iterator(container, true);
+        }
+    };
+
+}
@@ -0,0 +1,152 @@
+// anksilae@gmail.com
+
+
+/// @brief IndexPermutation: a list of container positions used by the index-driven iterators.
+/// @details Positions are stored as uint32_t while the container has fewer than 2^32 elements
+/// and as size_t beyond that, so sorting and traversing an int container moves half the bytes.
+#pragma once
+#include <vector>
+#include <memory_resource>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include "../storage/SmallVector.hpp"
+#include "../ContainerFwd.hpp"
+
+namespace containers
+{
+
+    class IndexPermutation
+    {
+    public:
+        /// @brief Permutations up to this size live inside the iterator, not on the heap.
+        static constexpr size_t inline_positions = 16;
+
+    private:
+        SmallVector<uint32_t, inline_positions> narrow; ///< Used when every position fits in 32 bits.
+        std::pmr::vector<size_t> wide;                  ///< Used for containers of 2^32 elements or more.
+        bool is_wide = false;
+
+    public:
+        /// @brief Creates an empty permutation allocating from the given resource.
+        explicit IndexPermutation(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+            : narrow(resource), wide(resource) {}
+
+        /// @brief True if positions of an n-element container need more than 32 bits.
+        static constexpr bool needs_wide(size_t n)
+        {
+            return n > static_cast<size_t>(std::numeric_limits<uint32_t>::max());
+        }
+
+        /// @brief Fills the permutation with the positions of items in ascending order.
+        /// @details Storages with their own sort_positions() (DictionaryStorage's counting
+        /// sort) fill it directly; everything else is sorted with storage_less().
+        template <typename Storage>
+        void assign_sorted(const Storage &items)
+        {
+            if constexpr (requires { items.sort_positions(narrow); items.sort_positions(wide); })
+            {
+                reset(items.size());
+                visit([&items](auto &idx)
+                      { items.sort_positions(idx); });
+            }
+            else
+            {
+                assign_identity(items.size());
+                sort([&items](size_t a, size_t b)
+                     { return storage_less(items, a, b); });
+            }
+        }
+
+        /// @brief Calls f with the underlying vector (of uint32_t or size_t).
+        template <typename F>
+        decltype(auto) visit(F &&f)
+        {
+            return is_wide ? f(wide) : f(narrow);
+        }
+
+        /// @brief Clears the permutation and prepares it for n positions.
+        void reset(size_t n)
+        {
+            narrow.clear();
+            wide.clear();
+            is_wide = needs_wide(n);
+            if (is_wide)
+                wide.reserve(n);
+            else
+                narrow.reserve(n);
+        }
+
+        /// @brief Fills the permutation with 0, 1, ..., n-1.
+        void assign_identity(size_t n)
+        {
+            reset(n);
+            visit([n](auto &idx)
+                  {
+                      using index_t = typename std::decay_t<decltype(idx)>::value_type;
+                      idx.resize(n);
+                      for (size_t i = 0; i < n; ++i)
+                          idx[i] = static_cast<index_t>(i); });
+        }
+
+        /// @brief Appends a position; reset() must have been called with the final size.
+        void push_back(size_t position)
+        {
+            if (is_wide)
+                wide.push_back(position);
+            else
+                narrow.push_back(static_cast<uint32_t>(position));
+        }
+
+        /// @brief Sorts the positions with a comparator over container positions.
+        template <typename Less>
+        void sort(Less less)
+        {
+            visit([&less](auto &idx)
+                  { std::sort(idx.begin(), idx.end(), less); });
+        }
+
+        /// @brief Returns the position stored at k.
+        size_t operator[](size_t k) const
+        {
+            return is_wide ? wide[k] : narrow[k];
+        }
+
+        /// @brief Returns the number of stored positions.
+        size_t size() const
+        {
+            return is_wide ? wide.size() : narrow.size();
+        }
+
+        /// @brief Returns the size of one stored position in bytes (4 or 8).
+        size_t index_bytes() const
+        {
+            return is_wide ? sizeof(size_t) : sizeof(uint32_t);
+        }
+    };
+
+    /// @brief The ascending permutation an index-driven iterator walks.
+    /// @details Refers to the container's shared sorted_indices() cache, except for containers
+    /// of at most inline_positions elements: those are sorted into the iterator's own inline
+    /// buffer, so traversing a small container allocates nothing, not even the side block that
+    /// holds the shared cache.
+    class SortedView
+    {
+    private:
+        const IndexPermutation *shared = nullptr;
+        IndexPermutation local;
+
+    public:
+        template <typename T, typename Storage>
+        explicit SortedView(const MyContainer<T, Storage> &c)
+        {
+            if (c.get_items().size() <= IndexPermutation::inline_positions)
+                local.assign_sorted(c.get_items());
+            else
+                shared = &c.sorted_indices();
+        }
+
+        const IndexPermutation &get() const { return shared ? *shared : local; }
+    };
+
+}
@@ -6,53 +6,56 @@
 /// For even-sized, the middle index is rounded down.
 #pragma once
 #include <vector>
+#include <memory_resource>
 #include <stdexcept>
-#include "../MyContainer.hpp"
+#include "IndexPermutation.hpp"
+#include "../ContainerFwd.hpp"
+#include "../trace/Trace.hpp"
 
 namespace containers {
 
-template<typename T>
+template<typename T, typename Storage = default_storage_t<T>>
 class MiddleOutOrder {
 private:
-    const MyContainer<T>& container;
+    const MyContainer<T, Storage>& container;
 
 public:
-    MiddleOutOrder(const MyContainer<T>& cont) : container(cont) {}
+    MiddleOutOrder(const MyContainer<T, Storage>& cont) : container(cont) {}
 
     class Iterator {
     private:
-        const MyContainer<T>& container;
-        const std::vector<T>& items;
-        std::vector<size_t> indices;
+        const MyContainer<T, Storage>& container;
+        const Storage& items;
+        IndexPermutation live;   ///< Physical positions of live elements, only while tombstones are pending.
+        size_t count;            ///< Number of live elements.
         size_t current;
         size_t expected_version;
 
+        size_t physical(size_t pos) const {
+            return live.size() != 0 ? live[pos] : pos;
+        }
+
     public:
             /// @brief Initializes the iterator.
             /// @param is_end Whether the iterator points to end.
-        Iterator(const MyContainer<T>& cont, bool is_end = false)
-            : container(cont), items(cont.get_items()), current(0), expected_version(cont.get_version()) {
-
-            size_t n = items.size();
-            if (n == 0) return;
-
-            int mid = n / 2;
-            int left = mid - 1;
-            int right = mid + 1;
-
-            indices.push_back(mid);
-            bool go_left = true;
-            while (left >= 0 || right < static_cast<int>(n)) {
-                if (go_left && left >= 0) {
-                    indices.push_back(left--);
-                } else if (!go_left && right < static_cast<int>(n)) {
-                    indices.push_back(right++);
-                }
-                go_left = !go_left;
+        Iterator(const MyContainer<T, Storage>& cont, bool is_end = false)
+            : container(cont), items(cont.get_items()), live(cont.get_resource()), count(cont.size()),
+              current(is_end ? count : 0), expected_version(cont.get_version()) {
+            if (cont.tombstone_count() != 0) {
+                CONTAINERS_TRACE_SCOPE("middle_out.live_index", count);
+                live.reset(count);
+                for (size_t i = cont.next_live(0); i < items.size(); i = cont.next_live(i + 1))
+                    live.push_back(i);
             }
+        }
 
-            if (is_end)
-                current = indices.size();
+            /// @brief Maps a step of the traversal to a container index.
+            /// @details Step 0 is the middle (n / 2); odd steps go left and even steps go right.
+            /// The left side is never shorter than the right one, so plain alternation visits
+            /// every index exactly once. Everything is size_t, so it holds past 2^31 elements.
+        static size_t position(size_t n, size_t step) {
+            size_t mid = n / 2;
+            return step % 2 == 1 ? mid - (step + 1) / 2 : mid + step / 2;
         }
 
             /// @brief Dereferences the iterator to get the current value.
@@ -60,19 +63,19 @@ public:
             /// @throws std::out_of_range if out of bounds.
         T operator*() const {
             if (expected_version != container.get_version()) {
-                throw std::runtime_error("Container modified during iteration");
+                container.throw_modified();
             }
-            if (current >= indices.size()) {
+            if (current >= count) {
                 throw std::out_of_range("Iterator out of bounds");
             }
-            return items[indices[current]];
+            return items[physical(position(count, current))];
         }
 
         Iterator& operator++() {
             if (expected_version != container.get_version()) {
-                throw std::runtime_error("Container modified during iteration");
+                container.throw_modified();
             }
-             if(current>= indices.size())
+             if(current >= count)
                 {
                     throw std::out_of_range("Iterator out of bounds");
                 }
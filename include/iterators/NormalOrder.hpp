@@ -5,56 +5,62 @@
 /// @details For example, on [7, 15, 6, 1, 2], the order is: 7, 15, 6, 1, 2.
 #pragma once
 #include <vector>
+#include <memory_resource>
 #include <stdexcept>
-#include "../MyContainer.hpp"
+#include "BlockCache.hpp"
+#include "../ContainerFwd.hpp"
 
 namespace containers {
 
-template <typename T>
+template <typename T, typename Storage = default_storage_t<T>>
 class NormalOrder {
 private:
-    const MyContainer<T>& container;
+    const MyContainer<T, Storage>& container;
+    [[no_unique_address]] BlockCache<T, Storage> blocks; ///< Shared by this range's iterators.
 
 public:
-    NormalOrder(const MyContainer<T>& cont) : container(cont) {}
+    NormalOrder(const MyContainer<T, Storage>& cont) : container(cont) {}
 
     class Iterator {
     private:
-        const MyContainer<T>& container;
-        const std::vector<T>& items;
+        const MyContainer<T, Storage>& container;
+        const Storage& items;
         size_t current;
         size_t expected_version;
+        [[no_unique_address]] BlockCacheRef<T, Storage> cache; ///< The range's decoded block, for PackedStorage.
 
     public:
             /// @brief Initializes the iterator.
             /// @param is_end Whether the iterator points to end.
-        Iterator(const MyContainer<T>& cont, bool is_end = false)
+            /// @param shared The range's decoded-block cache (PackedStorage); nullptr decodes per element.
+        Iterator(const MyContainer<T, Storage>& cont, bool is_end = false,
+                 const BlockCache<T, Storage>* shared = nullptr)
             : container(cont), items(cont.get_items()),
-              current(is_end ? items.size() : 0),
-              expected_version(cont.get_version()) {}
+              current(is_end ? items.size() : cont.next_live(0)),
+              expected_version(cont.get_version()), cache(shared) {}
 
             /// @brief Dereferences the iterator to get the current value.
             /// @throws std::runtime_error if modified during iteration.
             /// @throws std::out_of_range if out of bounds.
         T operator*() const {
             if (expected_version != container.get_version()) {
-                throw std::runtime_error("Container modified during iteration");
+                container.throw_modified();
             }
             if (current >= items.size()) {
                 throw std::out_of_range("Iterator out of bounds");
             }
-            return items[current];
+            return cache.get(items, current, expected_version);
         }
 
         Iterator& operator++() {
             if (expected_version != container.get_version()) {
-                throw std::runtime_error("Container modified during iteration");
+                container.throw_modified();
             }
              if(current>= container.get_items().size())
                 {
                     throw std::out_of_range("Iterator out of bounds");
                 }
-            ++current;
+            current = container.next_live(current + 1); // skips pending tombstones
             return *this;
         }
 
@@ -69,8 +75,15 @@ public:
         }
     };
 
-        /// @brief Returns iterator to beginning.
-    Iterator begin() const {
+        /// @brief Returns iterator to beginning. Its iterators share this range's decoded block,
+        /// so they must not outlive the range or be used from several threads at once.
+    Iterator begin() const& {
+        blocks.reset();
+        return Iterator(container, false, &blocks);
+    }
+
+        /// @brief Iterator of a temporary range (c.Normal().begin()); reads without the block cache.
+    Iterator begin() const&& {
         return Iterator(container, false);
     }
 
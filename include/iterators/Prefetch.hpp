@@ -0,0 +1,51 @@
+// anksilae@gmail.com
+
+
+/// @brief Software prefetching for the index-driven iterators.
+/// @details Ascending, Descending and SideCross read items[indices[k]], a random gather that
+/// misses the cache on every element once the container is larger than the last-level
+/// cache. While yielding step k they prefetch the element of step k + distance, so the load
+/// is already in flight when it is needed.
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace containers
+{
+
+    namespace detail
+    {
+        /// Read by every iterator constructor; relaxed, since it is a tuning knob, not a fence.
+        inline std::atomic<size_t> prefetch_steps{16};
+    }
+
+    /// @brief Sets how many steps ahead the iterators prefetch; 0 turns prefetching off.
+    /// @details Takes effect for iterators created afterwards. The best value depends on the
+    /// memory latency and on the work done per element; see Bench.cpp. Safe to call while
+    /// other threads iterate.
+    inline void set_prefetch_distance(size_t steps)
+    {
+        detail::prefetch_steps.store(steps, std::memory_order_relaxed);
+    }
+
+    /// @brief The current prefetch distance in steps.
+    inline size_t prefetch_distance()
+    {
+        return detail::prefetch_steps.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Prefetches items[pos] for reading. A no-op for storages that return elements by
+    /// value (StringArena, DictionaryStorage), which have no element address to prefetch.
+    template <typename Storage>
+    inline void prefetch_item(const Storage &items, size_t pos)
+    {
+        if constexpr (std::is_lvalue_reference_v<decltype(items[pos])>)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(&items[pos], 0, 1);
+#endif
+        }
+    }
+
+}
@@ -5,37 +5,43 @@
 /// @details For example, on [7, 15, 6, 1, 2], the order is: 2, 1, 6, 15, 7.
 #pragma once
 #include <vector>
+#include <memory_resource>
 #include <stdexcept>
-#include "../MyContainer.hpp"
+#include "BlockCache.hpp"
+#include "../ContainerFwd.hpp"
 
 namespace containers
 {
 
-    template <typename T>
+    template <typename T, typename Storage = default_storage_t<T>>
     class ReverseOrder
     {
     private:
-        const MyContainer<T> &container;
+        const MyContainer<T, Storage> &container;
+        [[no_unique_address]] BlockCache<T, Storage> blocks; ///< Shared by this range's iterators.
 
     public:
-        ReverseOrder(const MyContainer<T> &cont) : container(cont) {}
+        ReverseOrder(const MyContainer<T, Storage> &cont) : container(cont) {}
 
         class Iterator
         {
         private:
-            const MyContainer<T> &container;
-            const std::vector<T> &items;
-            int current;
+            const MyContainer<T, Storage> &container;
+            const Storage &items;
+            size_t current; ///< One past the current position: the current element is items[current - 1].
             size_t expected_version;
+            [[no_unique_address]] BlockCacheRef<T, Storage> cache; ///< The range's decoded block, for PackedStorage.
 
         public:
             /// @brief Initializes the iterator.
             /// @param is_end Whether the iterator points to end.
-            Iterator(const MyContainer<T> &cont, bool is_end = false)
+            /// @param shared The range's decoded-block cache (PackedStorage); nullptr decodes per element.
+            Iterator(const MyContainer<T, Storage> &cont, bool is_end = false,
+                     const BlockCache<T, Storage> *shared = nullptr)
                 : container(cont),
                   items(cont.get_items()),
-                  current(is_end ? -1 : static_cast<int>(items.size()) - 1),
-                  expected_version(cont.get_version()) {}
+                  current(is_end ? 0 : cont.live_before(items.size())),
+                  expected_version(cont.get_version()), cache(shared) {}
 
             /// @brief Dereferences the iterator to get the current value.
             /// @throws std::runtime_error if modified during iteration.
@@ -44,13 +50,13 @@ namespace containers
             {
                 if (expected_version != container.get_version())
                 {
-                    throw std::runtime_error("Container modified during iteration");
+                    container.throw_modified();
                 }
-                if (current < 0 || current > static_cast<int>(items.size()))
+                if (current == 0 || current > items.size())
                 {
                     throw std::out_of_range("Iterator out of bounds");
                 }
-                return items[current];
+                return cache.get(items, current - 1, expected_version);
             }
 
             /// @brief Advances to the next element.
@@ -60,13 +66,13 @@ namespace containers
             {
                 if (expected_version != container.get_version())
                 {
-                    throw std::runtime_error("Container modified during iteration");
+                    container.throw_modified();
                 }
-                 if(current < 0)
+                 if(current == 0)
                 {
                     throw std::out_of_range("Iterator out of bounds");
                 }
-                --current;
+                current = container.live_before(current - 1); // skips pending tombstones
                 return *this;
             }
 
@@ -83,8 +89,16 @@ namespace containers
             }
         };
 
-        /// @brief Returns iterator to beginning.
-        Iterator begin() const
+        /// @brief Returns iterator to beginning. Its iterators share this range's decoded
+        /// block, so they must not outlive the range or be used from several threads at once.
+        Iterator begin() const &
+        {
+            blocks.reset();
+            return Iterator(container, false, &blocks);
+        }
+
+        /// @brief Iterator of a temporary range (c.Reverse().begin()); reads without the block cache.
+        Iterator begin() const &&
         {
             return Iterator(container, false);
         }
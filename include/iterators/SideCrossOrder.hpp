@@ -5,73 +5,80 @@
 /// @details For example, on [7, 15, 6, 1, 2], the order is: 1, 15, 2, 7, 6.
 #pragma once
 #include <vector>
+#include <memory_resource>
 #include <algorithm>
 #include <stdexcept>
-#include "../MyContainer.hpp"
+#include "IndexPermutation.hpp"
+#include "Prefetch.hpp"
+#include "../ContainerFwd.hpp"
+#include "../trace/Trace.hpp"
 
 namespace containers
 {
 
-    template <typename T>
+    template <typename T, typename Storage = default_storage_t<T>>
     class SideCrossOrder
     {
     private:
-        const MyContainer<T> &container;
+        const MyContainer<T, Storage> &container;
 
     public:
-        SideCrossOrder(const MyContainer<T> &cont) : container(cont) {}
+        SideCrossOrder(const MyContainer<T, Storage> &cont) : container(cont) {}
 
         class Iterator
         {
         private:
-            const MyContainer<T> &container;
-            const std::vector<T> &items;
-            std::vector<size_t> indices;
+            const MyContainer<T, Storage> &container;
+            const Storage &items;
+            SortedView cached; ///< The ascending permutation (the container's cache, or inline when small).
+            IndexPermutation live_sorted;   ///< Live-only copy, built only while tombstones are pending.
+            bool filtered;
             size_t current;
             size_t expected_version;
+            size_t distance; ///< Prefetch distance in steps (0 = off).
+
+            const IndexPermutation &sorted() const
+            {
+                return filtered ? live_sorted : cached.get();
+            }
+
+            /// @brief Prefetches the element visited `ahead` steps after the current one.
+            void prefetch(size_t ahead) const
+            {
+                const IndexPermutation &perm = sorted();
+                if (current + ahead < perm.size())
+                    prefetch_item(items, perm[cross_slot(perm.size(), current + ahead)]);
+            }
 
         public:
             /// @brief Initializes the iterator.
             /// @param is_end Whether the iterator points to end.
-            Iterator(const MyContainer<T> &cont, bool is_end = false)
-                : container(cont), items(cont.get_items()), current(0),
-                  expected_version(cont.get_version())
+            Iterator(const MyContainer<T, Storage> &cont, bool is_end = false)
+                : container(cont), items(cont.get_items()), cached(cont),
+                  live_sorted(cont.get_resource()), filtered(cont.tombstone_count() != 0),
+                  current(0), expected_version(cont.get_version()), distance(prefetch_distance())
             {
-
-                size_t n = items.size();
-                if (n == 0) return;  // אם אין פריטים, אין צורך להמשיך
-                std::vector<size_t> sorted_indices(n);
-                for (size_t i = 0; i < n; ++i)
-                    sorted_indices[i] = i;
-
-                std::sort(sorted_indices.begin(), sorted_indices.end(),
-                          [&](size_t a, size_t b)
-                          {
-                              return items[a] < items[b];
-                          });
-
-                // בניית סדר cross: מינימום, מקסימום, 2nd min, 2nd max...
-                size_t left = 0, right = n - 1;
-                while (left <= right)
+                if (filtered)
                 {
-                    if (left == right)
-                    {
-                        indices.push_back(sorted_indices[left]);
-                    }
-                    else
-                    {
-                        indices.push_back(sorted_indices[left]);
-                        indices.push_back(sorted_indices[right]);
-                    }
-                    ++left;
-                    if (right > 0)
-                        --right;
+                    CONTAINERS_TRACE_SCOPE("side_cross.live_index", cont.size());
+                    live_sorted.reset(cont.size());
+                    for (size_t k = 0; k < cached.get().size(); ++k)
+                        if (cont.is_live(cached.get()[k]))
+                            live_sorted.push_back(cached.get()[k]);
                 }
-
                 if (is_end)
                 {
-                    current = indices.size();
+                    current = sorted().size();
                 }
+                for (size_t k = 0; !is_end && k < distance; ++k)
+                    prefetch(k);
+            }
+
+            /// @brief Maps a step to its slot in the sorted permutation: min, max, 2nd min, 2nd max...
+            /// @details Computed on the fly so no second cross-ordered index buffer is needed.
+            static size_t cross_slot(size_t n, size_t step)
+            {
+                return step % 2 == 0 ? step / 2 : n - 1 - step / 2;
             }
 
             /// @brief Dereferences the iterator to get the current value.
@@ -81,14 +88,14 @@ namespace containers
             {
                 if (expected_version != container.get_version())
                 {
-                    throw std::runtime_error("Container modified during iteration");
+                    container.throw_modified();
                 }
-                if (current >= indices.size())
+                if (current >= sorted().size())
                 {
                     throw std::out_of_range("Iterator out of bounds");
                 }
 
-                return items[indices[current]];
+                return items[sorted()[cross_slot(sorted().size(), current)]];
             }
 
             /// @brief Advances to the next element.
@@ -98,13 +105,15 @@ namespace containers
             {
                 if (expected_version != container.get_version())
                 {
-                    throw std::runtime_error("Container modified during iteration");
+                    container.throw_modified();
                 }
-                if (current >= indices.size())
+                if (current >= sorted().size())
                 {
                     throw std::out_of_range("Iterator out of bounds");
                 }
                 ++current;
+                if (distance != 0)
+                    prefetch(distance);
                 return *this;
             }
 
@@ -0,0 +1,114 @@
+// anksilae@gmail.com
+
+
+/// @brief SortedRuns: steps through the runs of equal values in a container's sorted permutation.
+/// @details Used by DistinctOrder and GroupedAscendingOrder. The end of each run is found by
+/// galloping (1, 2, 4, ... slots ahead, then a binary search), so a value repeated m times
+/// costs O(log m) comparisons rather than m. Runs are only scanned element by element while
+/// tombstones are pending, to leave the removed ones out of the count.
+#pragma once
+#include <algorithm>
+#include "IndexPermutation.hpp"
+#include "../ContainerFwd.hpp"
+
+namespace containers
+{
+
+    template <typename T, typename Storage>
+    class SortedRuns
+    {
+    private:
+        const MyContainer<T, Storage> *container;
+        const IndexPermutation *perm;
+        size_t first;     ///< First slot of the current run.
+        size_t last;      ///< One past the last slot of the current run.
+        size_t live;      ///< Live elements in the run.
+        size_t sample;    ///< Position of a live element of the run.
+
+        bool less(size_t a, size_t b) const
+        {
+            return storage_less(container->get_items(), (*perm)[a], (*perm)[b]);
+        }
+
+        /// @brief First slot after k whose value is greater than the value at k.
+        size_t run_end(size_t k) const
+        {
+            size_t n = perm->size();
+            size_t lo = k, step = 1;
+            while (lo + step < n && !less(k, lo + step))
+            {
+                lo += step;
+                step *= 2;
+            }
+            size_t hi = std::min(lo + step, n);
+            // Invariant: slot lo equals k, slot hi (if < n) is greater.
+            while (hi - lo > 1)
+            {
+                size_t mid = lo + (hi - lo) / 2;
+                if (less(k, mid))
+                    hi = mid;
+                else
+                    lo = mid;
+            }
+            return hi;
+        }
+
+        /// @brief Moves first forward to the next run that still has a live element.
+        void settle()
+        {
+            for (;; first = last)
+            {
+                if (first >= perm->size())
+                {
+                    first = last = perm->size();
+                    live = 0;
+                    return;
+                }
+                last = run_end(first);
+                if (container->tombstone_count() == 0)
+                {
+                    live = last - first;
+                    sample = (*perm)[first];
+                    return;
+                }
+                live = 0;
+                for (size_t k = first; k < last; ++k)
+                {
+                    if (container->is_live((*perm)[k]))
+                    {
+                        if (live++ == 0)
+                            sample = (*perm)[k];
+                    }
+                }
+                if (live != 0)
+                    return;
+            }
+        }
+
+    public:
+        /// @brief Starts at the first run, or at the end if at_end is set.
+        SortedRuns(const MyContainer<T, Storage> &cont, bool at_end)
+            : container(&cont), perm(&cont.sorted_indices()), first(at_end ? perm->size() : 0),
+              last(first), live(0), sample(0)
+        {
+            settle();
+        }
+
+        bool done() const { return first >= perm->size(); }
+        void next()
+        {
+            first = last;
+            settle();
+        }
+
+        /// @brief Slot where the current run starts; identifies the position for comparisons.
+        size_t slot() const { return first; }
+
+        /// @brief Value of the current run.
+        decltype(auto) value() const { return container->get_items()[sample]; }
+
+        /// @brief Number of live elements equal to value().
+        size_t count() const { return live; }
+    };
+
+}
@@ -0,0 +1,407 @@
+// anksilae@gmail.com
+
+
+/// @brief NUMA placement for container memory and node-local parallel traversal.
+/// @details NumaResource is a std::pmr::memory_resource that maps large blocks with mmap and
+/// places them with the mbind system call: interleaved page by page across all nodes, bound
+/// to one node, each block on the next node in turn (so a ChunkedContainer's chunks are
+/// partitioned across nodes), or each block cut into one contiguous range per node (so one
+/// large vector is partitioned). Passing it to MyContainer places the items and every cached
+/// index buffer. for_each_local_segment() then hands each worker thread, pinned to a node,
+/// the segments that live on that node. Topology comes from /sys and the raw syscalls, so no
+/// libnuma is needed; on single-node machines, non-Linux systems, or where mbind is refused,
+/// everything degrades to node 0 and ordinary allocation.
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../MyContainer.hpp"
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define CONTAINERS_NUMA_LINUX 1
+#endif
+
+namespace containers::numa
+{
+
+    namespace detail
+    {
+        // From <linux/mempolicy.h>; spelled out so the header does not need libnuma's numaif.h.
+        constexpr int mpol_preferred = 1;
+        constexpr int mpol_bind = 2;
+        constexpr int mpol_interleave = 3;
+        constexpr unsigned long mpol_f_node = 1;
+        constexpr unsigned long mpol_f_addr = 2;
+        constexpr size_t max_nodes = 64;
+
+        /// @brief Parses a /sys list such as "0-3,8,10-11".
+        inline std::vector<size_t> parse_list(const std::string &text)
+        {
+            std::vector<size_t> out;
+            size_t pos = 0;
+            while (pos < text.size())
+            {
+                size_t end = text.find(',', pos);
+                std::string part = text.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+                size_t dash = part.find('-');
+                try
+                {
+                    size_t lo = std::stoul(part.substr(0, dash));
+                    size_t hi = dash == std::string::npos ? lo : std::stoul(part.substr(dash + 1));
+                    for (size_t v = lo; v <= hi; ++v)
+                        out.push_back(v);
+                }
+                catch (const std::exception &)
+                {
+                    // Empty or malformed entry: skip it.
+                }
+                if (end == std::string::npos)
+                    break;
+                pos = end + 1;
+            }
+            return out;
+        }
+
+        inline std::string read_sys(const std::string &path)
+        {
+            std::ifstream in(path);
+            std::string line;
+            std::getline(in, line);
+            return line;
+        }
+
+        inline size_t page_size()
+        {
+#ifdef CONTAINERS_NUMA_LINUX
+            static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            return page;
+#else
+            return 4096;
+#endif
+        }
+    }
+
+    /// @brief Online NUMA nodes, e.g. {0, 1}; {0} when the topology is unknown.
+    inline const std::vector<size_t> &nodes()
+    {
+        static const std::vector<size_t> online = []
+        {
+            std::vector<size_t> list = detail::parse_list(detail::read_sys("/sys/devices/system/node/online"));
+            list.erase(std::remove_if(list.begin(), list.end(), [](size_t n)
+                                      { return n >= detail::max_nodes; }),
+                       list.end());
+            return list.empty() ? std::vector<size_t>{0} : list;
+        }();
+        return online;
+    }
+
+    /// @brief Number of online NUMA nodes (1 on single-node or unknown systems).
+    inline size_t node_count()
+    {
+        return nodes().size();
+    }
+
+    /// @brief Node holding the page at addr, or 0 if it cannot be determined.
+    inline size_t node_of(const void *addr)
+    {
+#ifdef CONTAINERS_NUMA_LINUX
+        if (node_count() > 1)
+        {
+            int node = -1;
+            if (::syscall(SYS_get_mempolicy, &node, nullptr, 0UL, const_cast<void *>(addr),
+                          detail::mpol_f_node | detail::mpol_f_addr) == 0 &&
+                node >= 0)
+                return static_cast<size_t>(node);
+        }
+#endif
+        (void)addr;
+        return 0;
+    }
+
+    /// @brief Pins the calling thread to the CPUs of node; returns false if that failed.
+    inline bool pin_to_node(size_t node)
+    {
+#ifdef CONTAINERS_NUMA_LINUX
+        std::vector<size_t> cpus = detail::parse_list(
+            detail::read_sys("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"));
+        if (cpus.empty())
+            return false;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (size_t cpu : cpus)
+            if (cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+        return ::sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        (void)node;
+        return false;
+#endif
+    }
+
+    /// @brief How NumaResource places the blocks it hands out.
+    enum class Placement
+    {
+        Interleave, ///< Pages of every block alternate across all nodes.
+        Bind,       ///< Every block on one node.
+        RoundRobin, ///< Each block on the next node in turn (partitions chunked storage).
+        Partition   ///< Each block cut into contiguous page-aligned ranges, one per node in order.
+    };
+
+    /// @brief Memory resource that places large blocks on NUMA nodes with mmap + mbind.
+    /// @details Blocks smaller than min_mapped_bytes come from the upstream resource, since a
+    /// mapping per small allocation would waste whole pages. Placement failures (single node,
+    /// no permission) are ignored: the memory is then simply allocated on first touch.
+    class NumaResource : public std::pmr::memory_resource
+    {
+    private:
+        Placement placement;
+        size_t bound_node;
+        size_t min_mapped;
+        std::pmr::memory_resource *upstream;
+        std::atomic<size_t> next_node{0};
+        std::atomic<size_t> placed{0};
+
+        static size_t page_round(size_t bytes)
+        {
+            size_t page = detail::page_size();
+            return (bytes + page - 1) / page * page;
+        }
+
+        /// @brief Binds [p, p + bytes) to node with mode; true if the kernel accepted it.
+        static bool bind_range(void *p, size_t bytes, int mode, size_t node)
+        {
+#ifdef CONTAINERS_NUMA_LINUX
+            unsigned long mask = 1UL << node;
+            return ::syscall(SYS_mbind, p, bytes, mode, &mask, detail::max_nodes + 1, 0U) == 0;
+#else
+            (void)p;
+            (void)bytes;
+            (void)mode;
+            (void)node;
+            return false;
+#endif
+        }
+
+        void place(void *p, size_t bytes)
+        {
+#ifdef CONTAINERS_NUMA_LINUX
+            if (node_count() < 2)
+                return;
+            if (placement == Placement::Partition)
+            {
+                // Whole pages per node, so every range boundary is page-aligned.
+                size_t pages = bytes / detail::page_size();
+                size_t share = (pages + node_count() - 1) / node_count() * detail::page_size();
+                bool all = true;
+                for (size_t k = 0; k < node_count() && k * share < bytes; ++k)
+                    all &= bind_range(static_cast<char *>(p) + k * share, std::min(share, bytes - k * share),
+                                      detail::mpol_preferred, nodes()[k]);
+                if (all)
+                    ++placed;
+                return;
+            }
+            unsigned long mask = 0;
+            int mode = detail::mpol_interleave;
+            switch (placement)
+            {
+            case Placement::Interleave:
+                for (size_t node : nodes())
+                    mask |= 1UL << node;
+                break;
+            case Placement::Bind:
+                mask = 1UL << bound_node;
+                mode = detail::mpol_bind;
+                break;
+            case Placement::RoundRobin:
+                mask = 1UL << nodes()[next_node++ % node_count()];
+                mode = detail::mpol_preferred;
+                break;
+            case Placement::Partition:
+                break;
+            }
+            if (::syscall(SYS_mbind, p, bytes, mode, &mask, detail::max_nodes + 1, 0U) == 0)
+                ++placed;
+#else
+            (void)p;
+            (void)bytes;
+#endif
+        }
+
+    protected:
+        void *do_allocate(size_t bytes, size_t alignment) override
+        {
+#ifdef CONTAINERS_NUMA_LINUX
+            if (bytes >= min_mapped && alignment <= detail::page_size())
+            {
+                size_t length = page_round(bytes);
+                void *p = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (p == MAP_FAILED)
+                    throw std::bad_alloc();
+                place(p, length);
+                return p;
+            }
+#endif
+            return upstream->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override
+        {
+#ifdef CONTAINERS_NUMA_LINUX
+            if (bytes >= min_mapped && alignment <= detail::page_size())
+            {
+                ::munmap(p, page_round(bytes));
+                return;
+            }
+#endif
+            upstream->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+    public:
+        /// @param node Target node for Placement::Bind (ignored otherwise).
+        /// @param min_mapped_bytes Smallest block that gets its own placed mapping.
+        explicit NumaResource(Placement how = Placement::Interleave, size_t node = 0,
+                              size_t min_mapped_bytes = size_t{64} << 10,
+                              std::pmr::memory_resource *upstream_resource = std::pmr::get_default_resource())
+            : placement(how), bound_node(node < detail::max_nodes ? node : 0), min_mapped(min_mapped_bytes),
+              upstream(upstream_resource) {}
+
+        /// @brief Number of blocks whose placement the kernel accepted (0 on single-node systems).
+        size_t placed_blocks() const { return placed; }
+
+        Placement placement_policy() const { return placement; }
+    };
+
+    namespace detail
+    {
+        /// @brief Cuts [data, data + n) into pieces of about piece_elements that each lie on one
+        /// node and calls emit(node, first, count) for them.
+        /// @details Piece ends fall on page boundaries. A piece whose first and last element sit on
+        /// different nodes is cut where the node changes, found by bisection; with
+        /// Partition placement that is exactly at the node ranges. Interleaved memory changes node
+        /// every page, so split_at_nodes = false keeps whole pieces there, labelled by the first page.
+        template <typename T, typename Emit>
+        void cut_by_node(const T *data, size_t n, size_t piece_elements, bool split_at_nodes, Emit &&emit)
+        {
+            const uintptr_t base = reinterpret_cast<uintptr_t>(data);
+            const uintptr_t page = page_size();
+            const uintptr_t piece_bytes = std::max<uintptr_t>(page, piece_elements * sizeof(T) / page * page);
+            // Index of the first element starting at or after address a.
+            auto first_from = [&](uintptr_t a)
+            { return std::min<size_t>(n, (a - base + sizeof(T) - 1) / sizeof(T)); };
+            size_t start = 0;
+            while (start < n)
+            {
+                uintptr_t at = base + start * sizeof(T);
+                size_t end = first_from(at / page * page + piece_bytes);
+                size_t node = node_of(data + start);
+                if (split_at_nodes && node_of(data + end - 1) != node)
+                {
+                    size_t lo = start, hi = end - 1; // node_of(lo) == node, node_of(hi) != node
+                    while (hi - lo > 1)
+                    {
+                        size_t mid = lo + (hi - lo) / 2;
+                        if (node_of(data + mid) == node)
+                            lo = mid;
+                        else
+                            hi = mid;
+                    }
+                    end = hi;
+                }
+                emit(node, start, end - start);
+                start = end;
+            }
+        }
+    }
+
+    /// @brief Calls f(node, data, n) for every segment of c, on worker threads pinned to the
+    /// node that holds the segment, so each worker reads node-local memory.
+    /// @details Contiguous storage is cut into pieces of about piece_elements, split further
+    /// where the node changes (see Placement::Partition); SegmentedVector storage is visited
+    /// chunk by chunk (allocate it from a RoundRobin NumaResource to spread the chunks). Each
+    /// node gets threads_per_node workers (0 = its share of the hardware threads). Tombstoned
+    /// elements are skipped. f must be safe to call concurrently. If f throws, or a worker
+    /// cannot be started, every started worker is joined and the first exception is rethrown.
+    template <typename T, typename Storage, typename F>
+        requires(contiguous_storage<Storage> || requires { Storage::chunk_size; })
+    void for_each_local_segment(const MyContainer<T, Storage> &c, F &&f, size_t threads_per_node = 0,
+                                size_t piece_elements = size_t{1} << 16)
+    {
+        struct Segment
+        {
+            const T *data;
+            size_t n;
+        };
+        auto *numa = dynamic_cast<const NumaResource *>(c.get_resource());
+        const bool split_at_nodes = !numa || numa->placement_policy() != Placement::Interleave;
+        std::vector<std::vector<Segment>> by_node(detail::max_nodes);
+        c.for_each_segment([&](const T *data, size_t n)
+                           { detail::cut_by_node(data, n, piece_elements, split_at_nodes,
+                                                 [&](size_t node, size_t first, size_t count)
+                                                 {
+                                                     if (node >= by_node.size())
+                                                         by_node.resize(node + 1);
+                                                     by_node[node].push_back(Segment{data + first, count});
+                                                 }); });
+
+        if (threads_per_node == 0)
+            threads_per_node = std::max<size_t>(1, std::thread::hardware_concurrency() / node_count());
+        size_t total = 0;
+        for (const std::vector<Segment> &segments : by_node)
+            total += std::min(threads_per_node, segments.size());
+        std::vector<std::exception_ptr> errors(total + 1); // the last slot records a failed spawn
+        std::vector<std::thread> workers;
+        workers.reserve(total);
+        try
+        {
+            for (size_t node = 0; node < by_node.size(); ++node)
+            {
+                const std::vector<Segment> &segments = by_node[node];
+                size_t count = std::min(threads_per_node, segments.size());
+                for (size_t t = 0; t < count; ++t)
+                {
+                    std::exception_ptr &error = errors[workers.size()];
+                    workers.emplace_back([&f, &segments, &error, node, t, count]
+                                         {
+                                             try
+                                             {
+                                                 if (node_count() > 1)
+                                                     pin_to_node(node);
+                                                 for (size_t k = t; k < segments.size(); k += count)
+                                                     f(node, segments[k].data, segments[k].n);
+                                             }
+                                             catch (...)
+                                             {
+                                                 error = std::current_exception();
+                                             } });
+                }
+            }
+        }
+        catch (...)
+        {
+            errors.back() = std::current_exception();
+        }
+        for (std::thread &w : workers)
+            w.join();
+        for (std::exception_ptr &e : errors)
+            if (e)
+                std::rethrow_exception(e);
+    }
+
+}
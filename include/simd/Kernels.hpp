@@ -0,0 +1,757 @@
+// anksilae@gmail.com
+
+
+/// @file Kernels.hpp
+/// @brief Vectorized sum / min / max / count / find / remove kernels for contiguous arithmetic
+/// data, plus the bit-unpacking kernel behind PackedStorage.
+/// @details int, float and double get AVX2 and AVX-512 implementations; every other type
+/// (and every CPU without those extensions) uses the scalar loops. The instruction set is
+/// picked once at runtime from CPUID, so the binary itself does not need -mavx2.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CONTAINERS_SIMD_X86 1
+#include <immintrin.h>
+#define CONTAINERS_AVX2 __attribute__((target("avx2"), always_inline)) inline
+#define CONTAINERS_AVX2_KERNEL __attribute__((target("avx2"))) inline
+#define CONTAINERS_AVX512 __attribute__((target("avx512f"), always_inline)) inline
+#define CONTAINERS_AVX512_KERNEL __attribute__((target("avx512f"))) inline
+#endif
+
+namespace containers::simd
+{
+
+    /// @brief Instruction set used by the kernels, ordered from weakest to strongest.
+    enum class Level
+    {
+        Scalar,
+        AVX2,
+        AVX512
+    };
+
+    /// @brief True for the element types that have hand-written vector kernels.
+    template <typename T>
+    inline constexpr bool is_vectorized_v =
+        std::is_same_v<T, int> || std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+    /// @brief Accumulator type of sum(): 64-bit for integers so large containers do not overflow.
+    template <typename T>
+    using sum_t = std::conditional_t<std::is_integral_v<T>,
+                                     std::conditional_t<std::is_signed_v<T>, long long, unsigned long long>,
+                                     T>;
+
+    namespace detail
+    {
+        /// @brief Best level supported by the running CPU.
+        inline Level detect_level()
+        {
+#ifdef CONTAINERS_SIMD_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f"))
+                return Level::AVX512;
+            if (__builtin_cpu_supports("avx2"))
+                return Level::AVX2;
+#endif
+            return Level::Scalar;
+        }
+
+        inline Level &active_level()
+        {
+            static Level level = detect_level();
+            return level;
+        }
+
+        // ---------------------------------------------------------------- scalar
+
+        template <typename T>
+        sum_t<T> sum_scalar(const T *data, size_t n)
+        {
+            sum_t<T> total{};
+            for (size_t i = 0; i < n; ++i)
+                total += data[i];
+            return total;
+        }
+
+        template <typename T>
+        std::pair<T, T> minmax_scalar(const T *data, size_t n)
+        {
+            T lo = data[0], hi = data[0];
+            for (size_t i = 1; i < n; ++i)
+            {
+                lo = data[i] < lo ? data[i] : lo;
+                hi = hi < data[i] ? data[i] : hi;
+            }
+            return {lo, hi};
+        }
+
+        template <typename T>
+        size_t count_scalar(const T *data, size_t n, const T &value)
+        {
+            size_t hits = 0;
+            for (size_t i = 0; i < n; ++i)
+                hits += (data[i] == value);
+            return hits;
+        }
+
+        /// @brief Compacts data[from..n) down to data[out..), keeping elements where !drop(x).
+        /// @details Every element is written unconditionally and the write cursor advances by
+        /// the predicate result, so there is no data-dependent branch in the loop.
+        template <typename T, typename Pred>
+        size_t compact_scalar(T *data, size_t from, size_t n, size_t out, Pred drop)
+        {
+            for (size_t i = from; i < n; ++i)
+            {
+                T x = data[i];
+                data[out] = x;
+                out += !drop(x);
+            }
+            return out;
+        }
+
+        template <typename T>
+        size_t find_scalar(const T *data, size_t n, const T &value)
+        {
+            return static_cast<size_t>(std::find(data, data + n, value) - data);
+        }
+
+        /// @brief Mask of the low bits bits (all ones for 64).
+        inline uint64_t low_bits(uint32_t bits)
+        {
+            return bits == 64 ? ~uint64_t{0} : (uint64_t{1} << bits) - 1;
+        }
+
+        /// @brief Fields from..n of unpack_bits(); the read of the next word is clamped to the
+        /// last word, which only matters for fields that do not straddle (and are masked).
+        inline void unpack_scalar(const uint64_t *w, uint32_t bits, uint64_t base, size_t from, size_t n, uint64_t *out)
+        {
+            size_t last = (n * bits + 63) / 64 - 1;
+            uint64_t mask = low_bits(bits);
+            for (size_t k = from; k < n; ++k)
+            {
+                size_t pos = k * bits;
+                size_t word = pos >> 6;
+                uint32_t shift = static_cast<uint32_t>(pos & 63);
+                uint64_t hi = shift == 0 ? 0 : w[std::min(word + 1, last)] << (64 - shift);
+                out[k] = base + (((w[word] >> shift) | hi) & mask);
+            }
+        }
+
+#ifdef CONTAINERS_SIMD_X86
+        // ---------------------------------------------------------------- AVX2
+
+        /// @brief For every keep-mask of Lanes lanes, a vpermd control that packs the kept
+        /// lanes to the front. 64-bit lanes are expressed as pairs of 32-bit lanes.
+        template <size_t Lanes>
+        constexpr auto make_compress_lut()
+        {
+            constexpr size_t words = 8 / Lanes;
+            std::array<std::array<uint32_t, 8>, (1u << Lanes)> lut{};
+            for (size_t mask = 0; mask < lut.size(); ++mask)
+            {
+                size_t k = 0;
+                for (size_t lane = 0; lane < Lanes; ++lane)
+                    if (mask & (1u << lane))
+                    {
+                        for (size_t w = 0; w < words; ++w)
+                            lut[mask][k * words + w] = static_cast<uint32_t>(lane * words + w);
+                        ++k;
+                    }
+            }
+            return lut;
+        }
+
+        alignas(32) inline constexpr auto compress_lut8 = make_compress_lut<8>();
+        alignas(32) inline constexpr auto compress_lut4 = make_compress_lut<4>();
+
+        namespace avx2
+        {
+            struct Int
+            {
+                using value_type = int;
+                using reg = __m256i;
+                using acc = __m256i; ///< Four 64-bit partial sums.
+                static constexpr size_t width = 8;
+
+                CONTAINERS_AVX2 static reg load(const int *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+                CONTAINERS_AVX2 static reg set1(int x) { return _mm256_set1_epi32(x); }
+                CONTAINERS_AVX2 static reg min(reg a, reg b) { return _mm256_min_epi32(a, b); }
+                CONTAINERS_AVX2 static reg max(reg a, reg b) { return _mm256_max_epi32(a, b); }
+                CONTAINERS_AVX2 static unsigned eq_mask(reg a, reg b)
+                {
+                    return static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))));
+                }
+                CONTAINERS_AVX2 static size_t compress_store(int *out, reg v, unsigned keep)
+                {
+                    auto perm = _mm256_load_si256(reinterpret_cast<const __m256i *>(compress_lut8[keep].data()));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), _mm256_permutevar8x32_epi32(v, perm));
+                    return static_cast<size_t>(__builtin_popcount(keep));
+                }
+                CONTAINERS_AVX2 static acc acc_zero() { return _mm256_setzero_si256(); }
+                CONTAINERS_AVX2 static acc accumulate(acc a, reg v)
+                {
+                    a = _mm256_add_epi64(a, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+                    return _mm256_add_epi64(a, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+                }
+                CONTAINERS_AVX2 static long long reduce_acc(acc a)
+                {
+                    alignas(32) long long lanes[4];
+                    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), a);
+                    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+                }
+                CONTAINERS_AVX2 static int reduce_min(reg v)
+                {
+                    alignas(32) int lanes[8];
+                    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), v);
+                    return *std::min_element(lanes, lanes + 8);
+                }
+                CONTAINERS_AVX2 static int reduce_max(reg v)
+                {
+                    alignas(32) int lanes[8];
+                    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), v);
+                    return *std::max_element(lanes, lanes + 8);
+                }
+            };
+
+            struct Float
+            {
+                using value_type = float;
+                using reg = __m256;
+                using acc = __m256;
+                static constexpr size_t width = 8;
+
+                CONTAINERS_AVX2 static reg load(const float *p) { return _mm256_loadu_ps(p); }
+                CONTAINERS_AVX2 static reg set1(float x) { return _mm256_set1_ps(x); }
+                CONTAINERS_AVX2 static reg min(reg a, reg b) { return _mm256_min_ps(a, b); }
+                CONTAINERS_AVX2 static reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+                CONTAINERS_AVX2 static unsigned eq_mask(reg a, reg b)
+                {
+                    return static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)));
+                }
+                CONTAINERS_AVX2 static size_t compress_store(float *out, reg v, unsigned keep)
+                {
+                    auto perm = _mm256_load_si256(reinterpret_cast<const __m256i *>(compress_lut8[keep].data()));
+                    _mm256_storeu_ps(out, _mm256_permutevar8x32_ps(v, perm));
+                    return static_cast<size_t>(__builtin_popcount(keep));
+                }
+                CONTAINERS_AVX2 static acc acc_zero() { return _mm256_setzero_ps(); }
+                CONTAINERS_AVX2 static acc accumulate(acc a, reg v) { return _mm256_add_ps(a, v); }
+                CONTAINERS_AVX2 static float reduce_acc(acc a)
+                {
+                    alignas(32) float lanes[8];
+                    _mm256_store_ps(lanes, a);
+                    return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+                }
+                CONTAINERS_AVX2 static float reduce_min(reg v)
+                {
+                    alignas(32) float lanes[8];
+                    _mm256_store_ps(lanes, v);
+                    return *std::min_element(lanes, lanes + 8);
+                }
+                CONTAINERS_AVX2 static float reduce_max(reg v)
+                {
+                    alignas(32) float lanes[8];
+                    _mm256_store_ps(lanes, v);
+                    return *std::max_element(lanes, lanes + 8);
+                }
+            };
+
+            struct Double
+            {
+                using value_type = double;
+                using reg = __m256d;
+                using acc = __m256d;
+                static constexpr size_t width = 4;
+
+                CONTAINERS_AVX2 static reg load(const double *p) { return _mm256_loadu_pd(p); }
+                CONTAINERS_AVX2 static reg set1(double x) { return _mm256_set1_pd(x); }
+                CONTAINERS_AVX2 static reg min(reg a, reg b) { return _mm256_min_pd(a, b); }
+                CONTAINERS_AVX2 static reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+                CONTAINERS_AVX2 static unsigned eq_mask(reg a, reg b)
+                {
+                    return static_cast<unsigned>(_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)));
+                }
+                CONTAINERS_AVX2 static size_t compress_store(double *out, reg v, unsigned keep)
+                {
+                    auto perm = _mm256_load_si256(reinterpret_cast<const __m256i *>(compress_lut4[keep].data()));
+                    _mm256_storeu_pd(out, _mm256_castps_pd(_mm256_permutevar8x32_ps(_mm256_castpd_ps(v), perm)));
+                    return static_cast<size_t>(__builtin_popcount(keep));
+                }
+                CONTAINERS_AVX2 static acc acc_zero() { return _mm256_setzero_pd(); }
+                CONTAINERS_AVX2 static acc accumulate(acc a, reg v) { return _mm256_add_pd(a, v); }
+                CONTAINERS_AVX2 static double reduce_acc(acc a)
+                {
+                    alignas(32) double lanes[4];
+                    _mm256_store_pd(lanes, a);
+                    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+                }
+                CONTAINERS_AVX2 static double reduce_min(reg v)
+                {
+                    alignas(32) double lanes[4];
+                    _mm256_store_pd(lanes, v);
+                    return *std::min_element(lanes, lanes + 4);
+                }
+                CONTAINERS_AVX2 static double reduce_max(reg v)
+                {
+                    alignas(32) double lanes[4];
+                    _mm256_store_pd(lanes, v);
+                    return *std::max_element(lanes, lanes + 4);
+                }
+            };
+
+            template <typename V>
+            CONTAINERS_AVX2_KERNEL sum_t<typename V::value_type> sum(const typename V::value_type *data, size_t n)
+            {
+                auto acc0 = V::acc_zero(), acc1 = V::acc_zero();
+                size_t i = 0;
+                for (; i + 2 * V::width <= n; i += 2 * V::width)
+                {
+                    acc0 = V::accumulate(acc0, V::load(data + i));
+                    acc1 = V::accumulate(acc1, V::load(data + i + V::width));
+                }
+                for (; i + V::width <= n; i += V::width)
+                    acc0 = V::accumulate(acc0, V::load(data + i));
+                sum_t<typename V::value_type> total = V::reduce_acc(acc0) + V::reduce_acc(acc1);
+                return total + sum_scalar(data + i, n - i);
+            }
+
+            template <typename V>
+            CONTAINERS_AVX2_KERNEL std::pair<typename V::value_type, typename V::value_type>
+            minmax(const typename V::value_type *data, size_t n)
+            {
+                if (n < V::width)
+                    return minmax_scalar(data, n);
+                auto lo = V::load(data), hi = lo;
+                size_t i = V::width;
+                for (; i + V::width <= n; i += V::width)
+                {
+                    auto v = V::load(data + i);
+                    lo = V::min(lo, v);
+                    hi = V::max(hi, v);
+                }
+                // Fold the tail in by re-reading the last full vector; min/max are idempotent.
+                auto tail = V::load(data + n - V::width);
+                return {V::reduce_min(V::min(lo, tail)), V::reduce_max(V::max(hi, tail))};
+            }
+
+            template <typename V>
+            CONTAINERS_AVX2_KERNEL size_t count(const typename V::value_type *data, size_t n, typename V::value_type value)
+            {
+                const auto needle = V::set1(value);
+                size_t hits = 0, i = 0;
+                for (; i + V::width <= n; i += V::width)
+                    hits += static_cast<size_t>(__builtin_popcount(V::eq_mask(V::load(data + i), needle)));
+                return hits + count_scalar(data + i, n - i, value);
+            }
+
+            template <typename V>
+            CONTAINERS_AVX2_KERNEL size_t find(const typename V::value_type *data, size_t n, typename V::value_type value)
+            {
+                const auto needle = V::set1(value);
+                size_t i = 0;
+                for (; i + V::width <= n; i += V::width)
+                {
+                    unsigned mask = V::eq_mask(V::load(data + i), needle);
+                    if (mask)
+                        return i + static_cast<size_t>(__builtin_ctz(mask));
+                }
+                return i + find_scalar(data + i, n - i, value);
+            }
+
+            template <typename V>
+            CONTAINERS_AVX2_KERNEL size_t remove(typename V::value_type *data, size_t n, typename V::value_type value)
+            {
+                using T = typename V::value_type;
+                const auto needle = V::set1(value);
+                constexpr unsigned all_lanes = (1u << V::width) - 1;
+                size_t out = 0, i = 0;
+                // The store may write a full vector at `out`, but out <= i, so it only
+                // touches lanes that have already been loaded.
+                for (; i + V::width <= n; i += V::width)
+                {
+                    auto v = V::load(data + i);
+                    out += V::compress_store(data + out, v, ~V::eq_mask(v, needle) & all_lanes);
+                }
+                return compact_scalar(data, i, n, out, [value](T x)
+                                      { return x == value; });
+            }
+
+            /// @brief unpack_bits() four fields at a time: each lane gathers the word holding
+            /// its field and the next one and shifts them with per-lane variable shifts
+            /// (a shift by 64 yields 0, which covers fields that start on a word boundary).
+            CONTAINERS_AVX2_KERNEL void unpack(const uint64_t *w, uint32_t bits, uint64_t base, size_t n, uint64_t *out)
+            {
+                const long long *words = reinterpret_cast<const long long *>(w);
+                long long last = static_cast<long long>((n * bits + 63) / 64 - 1);
+                const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(low_bits(bits)));
+                const __m256i vbase = _mm256_set1_epi64x(static_cast<long long>(base));
+                const __m256i vlast = _mm256_set1_epi64x(last);
+                const __m256i one = _mm256_set1_epi64x(1);
+                const __m256i low6 = _mm256_set1_epi64x(63);
+                const __m256i sixty_four = _mm256_set1_epi64x(64);
+                const __m256i step = _mm256_set1_epi64x(4 * static_cast<long long>(bits));
+                long long b = bits;
+                __m256i pos = _mm256_setr_epi64x(0, b, 2 * b, 3 * b);
+                size_t k = 0;
+                for (; k + 4 <= n; k += 4)
+                {
+                    __m256i word = _mm256_srli_epi64(pos, 6);
+                    __m256i shift = _mm256_and_si256(pos, low6);
+                    __m256i next = _mm256_add_epi64(word, one);
+                    next = _mm256_blendv_epi8(next, vlast, _mm256_cmpgt_epi64(next, vlast));
+                    __m256i lo = _mm256_i64gather_epi64(words, word, 8);
+                    __m256i hi = _mm256_i64gather_epi64(words, next, 8);
+                    __m256i v = _mm256_or_si256(_mm256_srlv_epi64(lo, shift),
+                                                _mm256_sllv_epi64(hi, _mm256_sub_epi64(sixty_four, shift)));
+                    v = _mm256_add_epi64(_mm256_and_si256(v, mask), vbase);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + k), v);
+                    pos = _mm256_add_epi64(pos, step);
+                }
+                unpack_scalar(w, bits, base, k, n, out);
+            }
+        }
+
+        // ---------------------------------------------------------------- AVX-512
+
+        namespace avx512
+        {
+            struct Int
+            {
+                using value_type = int;
+                using reg = __m512i;
+                using acc = __m512i; ///< Eight 64-bit partial sums.
+                static constexpr size_t width = 16;
+
+                CONTAINERS_AVX512 static reg load(const int *p) { return _mm512_loadu_si512(p); }
+                CONTAINERS_AVX512 static reg set1(int x) { return _mm512_set1_epi32(x); }
+                CONTAINERS_AVX512 static reg min(reg a, reg b) { return _mm512_min_epi32(a, b); }
+                CONTAINERS_AVX512 static reg max(reg a, reg b) { return _mm512_max_epi32(a, b); }
+                CONTAINERS_AVX512 static unsigned eq_mask(reg a, reg b) { return _mm512_cmpeq_epi32_mask(a, b); }
+                CONTAINERS_AVX512 static size_t compress_store(int *out, reg v, unsigned keep)
+                {
+                    _mm512_mask_compressstoreu_epi32(out, static_cast<__mmask16>(keep), v);
+                    return static_cast<size_t>(__builtin_popcount(keep));
+                }
+                CONTAINERS_AVX512 static acc acc_zero() { return _mm512_setzero_si512(); }
+                CONTAINERS_AVX512 static acc accumulate(acc a, reg v)
+                {
+                    a = _mm512_add_epi64(a, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(v)));
+                    return _mm512_add_epi64(a, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(v, 1)));
+                }
+                CONTAINERS_AVX512 static long long reduce_acc(acc a) { return _mm512_reduce_add_epi64(a); }
+                CONTAINERS_AVX512 static int reduce_min(reg v) { return _mm512_reduce_min_epi32(v); }
+                CONTAINERS_AVX512 static int reduce_max(reg v) { return _mm512_reduce_max_epi32(v); }
+            };
+
+            struct Float
+            {
+                using value_type = float;
+                using reg = __m512;
+                using acc = __m512;
+                static constexpr size_t width = 16;
+
+                CONTAINERS_AVX512 static reg load(const float *p) { return _mm512_loadu_ps(p); }
+                CONTAINERS_AVX512 static reg set1(float x) { return _mm512_set1_ps(x); }
+                CONTAINERS_AVX512 static reg min(reg a, reg b) { return _mm512_min_ps(a, b); }
+                CONTAINERS_AVX512 static reg max(reg a, reg b) { return _mm512_max_ps(a, b); }
+                CONTAINERS_AVX512 static unsigned eq_mask(reg a, reg b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+                CONTAINERS_AVX512 static size_t compress_store(float *out, reg v, unsigned keep)
+                {
+                    _mm512_mask_compressstoreu_ps(out, static_cast<__mmask16>(keep), v);
+                    return static_cast<size_t>(__builtin_popcount(keep));
+                }
+                CONTAINERS_AVX512 static acc acc_zero() { return _mm512_setzero_ps(); }
+                CONTAINERS_AVX512 static acc accumulate(acc a, reg v) { return _mm512_add_ps(a, v); }
+                CONTAINERS_AVX512 static float reduce_acc(acc a) { return _mm512_reduce_add_ps(a); }
+                CONTAINERS_AVX512 static float reduce_min(reg v) { return _mm512_reduce_min_ps(v); }
+                CONTAINERS_AVX512 static float reduce_max(reg v) { return _mm512_reduce_max_ps(v); }
+            };
+
+            struct Double
+            {
+                using value_type = double;
+                using reg = __m512d;
+                using acc = __m512d;
+                static constexpr size_t width = 8;
+
+                CONTAINERS_AVX512 static reg load(const double *p) { return _mm512_loadu_pd(p); }
+                CONTAINERS_AVX512 static reg set1(double x) { return _mm512_set1_pd(x); }
+                CONTAINERS_AVX512 static reg min(reg a, reg b) { return _mm512_min_pd(a, b); }
+                CONTAINERS_AVX512 static reg max(reg a, reg b) { return _mm512_max_pd(a, b); }
+                CONTAINERS_AVX512 static unsigned eq_mask(reg a, reg b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+                CONTAINERS_AVX512 static size_t compress_store(double *out, reg v, unsigned keep)
+                {
+                    _mm512_mask_compressstoreu_pd(out, static_cast<__mmask8>(keep), v);
+                    return static_cast<size_t>(__builtin_popcount(keep));
+                }
+                CONTAINERS_AVX512 static acc acc_zero() { return _mm512_setzero_pd(); }
+                CONTAINERS_AVX512 static acc accumulate(acc a, reg v) { return _mm512_add_pd(a, v); }
+                CONTAINERS_AVX512 static double reduce_acc(acc a) { return _mm512_reduce_add_pd(a); }
+                CONTAINERS_AVX512 static double reduce_min(reg v) { return _mm512_reduce_min_pd(v); }
+                CONTAINERS_AVX512 static double reduce_max(reg v) { return _mm512_reduce_max_pd(v); }
+            };
+
+            template <typename V>
+            CONTAINERS_AVX512_KERNEL sum_t<typename V::value_type> sum(const typename V::value_type *data, size_t n)
+            {
+                auto acc0 = V::acc_zero(), acc1 = V::acc_zero();
+                size_t i = 0;
+                for (; i + 2 * V::width <= n; i += 2 * V::width)
+                {
+                    acc0 = V::accumulate(acc0, V::load(data + i));
+                    acc1 = V::accumulate(acc1, V::load(data + i + V::width));
+                }
+                for (; i + V::width <= n; i += V::width)
+                    acc0 = V::accumulate(acc0, V::load(data + i));
+                sum_t<typename V::value_type> total = V::reduce_acc(acc0) + V::reduce_acc(acc1);
+                return total + sum_scalar(data + i, n - i);
+            }
+
+            template <typename V>
+            CONTAINERS_AVX512_KERNEL std::pair<typename V::value_type, typename V::value_type>
+            minmax(const typename V::value_type *data, size_t n)
+            {
+                if (n < V::width)
+                    return minmax_scalar(data, n);
+                auto lo = V::load(data), hi = lo;
+                size_t i = V::width;
+                for (; i + V::width <= n; i += V::width)
+                {
+                    auto v = V::load(data + i);
+                    lo = V::min(lo, v);
+                    hi = V::max(hi, v);
+                }
+                auto tail = V::load(data + n - V::width);
+                return {V::reduce_min(V::min(lo, tail)), V::reduce_max(V::max(hi, tail))};
+            }
+
+            template <typename V>
+            CONTAINERS_AVX512_KERNEL size_t count(const typename V::value_type *data, size_t n, typename V::value_type value)
+            {
+                const auto needle = V::set1(value);
+                size_t hits = 0, i = 0;
+                for (; i + V::width <= n; i += V::width)
+                    hits += static_cast<size_t>(__builtin_popcount(V::eq_mask(V::load(data + i), needle)));
+                return hits + count_scalar(data + i, n - i, value);
+            }
+
+            template <typename V>
+            CONTAINERS_AVX512_KERNEL size_t find(const typename V::value_type *data, size_t n, typename V::value_type value)
+            {
+                const auto needle = V::set1(value);
+                size_t i = 0;
+                for (; i + V::width <= n; i += V::width)
+                {
+                    unsigned mask = V::eq_mask(V::load(data + i), needle);
+                    if (mask)
+                        return i + static_cast<size_t>(__builtin_ctz(mask));
+                }
+                return i + find_scalar(data + i, n - i, value);
+            }
+
+            template <typename V>
+            CONTAINERS_AVX512_KERNEL size_t remove(typename V::value_type *data, size_t n, typename V::value_type value)
+            {
+                using T = typename V::value_type;
+                const auto needle = V::set1(value);
+                constexpr unsigned all_lanes = (1u << V::width) - 1;
+                size_t out = 0, i = 0;
+                for (; i + V::width <= n; i += V::width)
+                {
+                    auto v = V::load(data + i);
+                    out += V::compress_store(data + out, v, ~V::eq_mask(v, needle) & all_lanes);
+                }
+                return compact_scalar(data, i, n, out, [value](T x)
+                                      { return x == value; });
+            }
+        }
+
+        /// @brief Maps an element type to its AVX2 / AVX-512 traits.
+        template <typename T>
+        struct traits;
+        template <>
+        struct traits<int>
+        {
+            using avx2_t = avx2::Int;
+            using avx512_t = avx512::Int;
+        };
+        template <>
+        struct traits<float>
+        {
+            using avx2_t = avx2::Float;
+            using avx512_t = avx512::Float;
+        };
+        template <>
+        struct traits<double>
+        {
+            using avx2_t = avx2::Double;
+            using avx512_t = avx512::Double;
+        };
+#endif
+    }
+
+    /// @brief Returns the instruction set the kernels currently dispatch to.
+    inline Level level()
+    {
+        return detail::active_level();
+    }
+
+    /// @brief Forces a lower instruction set (e.g. to compare paths in tests or benchmarks).
+    /// @details Requests above what the CPU supports are clamped to the detected level.
+    inline void set_level(Level requested)
+    {
+        Level supported = detail::detect_level();
+        detail::active_level() = requested < supported ? requested : supported;
+    }
+
+    /// @brief Sum of data[0..n). Integers accumulate in 64 bits.
+    template <typename T>
+    sum_t<T> sum(const T *data, size_t n)
+    {
+#ifdef CONTAINERS_SIMD_X86
+        if constexpr (is_vectorized_v<T>)
+        {
+            switch (level())
+            {
+            case Level::AVX512:
+                return detail::avx512::sum<typename detail::traits<T>::avx512_t>(data, n);
+            case Level::AVX2:
+                return detail::avx2::sum<typename detail::traits<T>::avx2_t>(data, n);
+            default:
+                break;
+            }
+        }
+#endif
+        return detail::sum_scalar(data, n);
+    }
+
+    /// @brief Smallest and largest of data[0..n). Requires n > 0.
+    /// @details For floating point data containing NaN the result is unspecified.
+    template <typename T>
+    std::pair<T, T> minmax(const T *data, size_t n)
+    {
+#ifdef CONTAINERS_SIMD_X86
+        if constexpr (is_vectorized_v<T>)
+        {
+            switch (level())
+            {
+            case Level::AVX512:
+                return detail::avx512::minmax<typename detail::traits<T>::avx512_t>(data, n);
+            case Level::AVX2:
+                return detail::avx2::minmax<typename detail::traits<T>::avx2_t>(data, n);
+            default:
+                break;
+            }
+        }
+#endif
+        return detail::minmax_scalar(data, n);
+    }
+
+    /// @brief Number of elements in data[0..n) equal to value.
+    template <typename T>
+    size_t count(const T *data, size_t n, const T &value)
+    {
+#ifdef CONTAINERS_SIMD_X86
+        if constexpr (is_vectorized_v<T>)
+        {
+            switch (level())
+            {
+            case Level::AVX512:
+                return detail::avx512::count<typename detail::traits<T>::avx512_t>(data, n, value);
+            case Level::AVX2:
+                return detail::avx2::count<typename detail::traits<T>::avx2_t>(data, n, value);
+            default:
+                break;
+            }
+        }
+#endif
+        return detail::count_scalar(data, n, value);
+    }
+
+    /// @brief Index of the first element equal to value, or n if there is none.
+    template <typename T>
+    size_t find(const T *data, size_t n, const T &value)
+    {
+#ifdef CONTAINERS_SIMD_X86
+        if constexpr (is_vectorized_v<T>)
+        {
+            switch (level())
+            {
+            case Level::AVX512:
+                return detail::avx512::find<typename detail::traits<T>::avx512_t>(data, n, value);
+            case Level::AVX2:
+                return detail::avx2::find<typename detail::traits<T>::avx2_t>(data, n, value);
+            default:
+                break;
+            }
+        }
+#endif
+        return detail::find_scalar(data, n, value);
+    }
+
+    /// @brief Removes every element equal to value from data[0..n) in one pass, keeping order.
+    /// @return The new logical length; data[length..n) is left unspecified.
+    /// @details int / float / double use AVX-512 compress-store or an AVX2 permute table,
+    /// other trivially copyable types a branchless scalar loop, and anything else std::remove.
+    template <typename T>
+    size_t remove(T *data, size_t n, const T &value)
+    {
+#ifdef CONTAINERS_SIMD_X86
+        if constexpr (is_vectorized_v<T>)
+        {
+            switch (level())
+            {
+            case Level::AVX512:
+                return detail::avx512::remove<typename detail::traits<T>::avx512_t>(data, n, value);
+            case Level::AVX2:
+                return detail::avx2::remove<typename detail::traits<T>::avx2_t>(data, n, value);
+            default:
+                break;
+            }
+        }
+#endif
+        return remove_if(data, n, [&value](const T &x)
+                         { return x == value; });
+    }
+
+    /// @brief Decodes n fields of bits bits each, packed back to back (LSB first) into w,
+    /// writing base + field to out[k] with wrapping 64-bit arithmetic.
+    /// @details AVX2 and AVX-512 CPUs use a gather-and-shift kernel; others the scalar loop.
+    inline void unpack_bits(const uint64_t *w, uint32_t bits, uint64_t base, size_t n, uint64_t *out)
+    {
+        if (bits == 0)
+        {
+            std::fill(out, out + n, base);
+            return;
+        }
+#ifdef CONTAINERS_SIMD_X86
+        if (level() != Level::Scalar)
+        {
+            detail::avx2::unpack(w, bits, base, n, out);
+            return;
+        }
+#endif
+        detail::unpack_scalar(w, bits, base, 0, n, out);
+    }
+
+    /// @brief Removes every element for which pred returns true, keeping order.
+    /// @return The new logical length; data[length..n) is left unspecified.
+    template <typename T, typename Pred>
+    size_t remove_if(T *data, size_t n, Pred pred)
+    {
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            return detail::compact_scalar(data, 0, n, 0, pred);
+        }
+        else
+        {
+            return static_cast<size_t>(std::remove_if(data, data + n, pred) - data);
+        }
+    }
+
+}
@@ -0,0 +1,258 @@
+// anksilae@gmail.com
+
+
+/// @brief QuantileSketch: mergeable streaming quantiles with a relative error bound (DDSketch).
+/// @details Values are counted in logarithmic buckets: bucket i holds (gamma^(i-1), gamma^i]
+/// with gamma = (1 + a) / (1 - a), and reports 2 gamma^i / (gamma + 1), which is within a
+/// relative error a of every value in it. Unlike KLL or t-digest, a bucket count can simply
+/// be decremented, so the sketch follows MyContainer::remove() exactly. Two sketches with the
+/// same accuracy merge by adding bucket counts. Each sign keeps at most max_bins buckets: when
+/// the values span more, the lowest buckets are collapsed into one (DDSketch's collapsing
+/// store), so memory and quantile() stay O(max_bins) and the error bound still holds for the
+/// quantiles above the collapsed range.
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <numeric>
+#include <limits>
+#include <memory_resource>
+#include <stdexcept>
+#include <vector>
+
+namespace containers
+{
+
+    class QuantileSketch
+    {
+    private:
+        /// @brief Dense bucket counts for indices offset, offset + 1, ..., at most max_bins of them.
+        /// @details Once the window is full, indices below it are counted in the lowest bucket.
+        struct Store
+        {
+            std::pmr::vector<uint64_t> bins;
+            int offset = 0;
+            size_t max_bins;
+            bool collapsed = false; ///< bins[0] also holds every index below offset.
+
+            Store(size_t limit, std::pmr::memory_resource *resource) : bins(resource), max_bins(limit) {}
+
+            /// @brief Moves the window up so that it starts at lowest, folding the bins below into it.
+            void collapse_below(int lowest)
+            {
+                size_t fold = std::min(bins.size(), static_cast<size_t>(static_cast<int64_t>(lowest) - offset));
+                uint64_t folded = std::accumulate(bins.begin(), bins.begin() + static_cast<std::ptrdiff_t>(fold), uint64_t{0});
+                bins.erase(bins.begin(), bins.begin() + static_cast<std::ptrdiff_t>(fold));
+                if (bins.empty() || static_cast<int64_t>(offset) + static_cast<int64_t>(fold) != lowest)
+                    bins.insert(bins.begin(), 0);
+                bins[0] += folded;
+                offset = lowest;
+                collapsed = true;
+            }
+
+            void add(int index, uint64_t n)
+            {
+                if (bins.empty())
+                {
+                    offset = index;
+                    bins.push_back(0);
+                }
+                else if (index < offset)
+                {
+                    int64_t top = static_cast<int64_t>(offset) + static_cast<int64_t>(bins.size()) - 1;
+                    int64_t lowest = collapsed ? offset : std::max<int64_t>(index, top - static_cast<int64_t>(max_bins) + 1);
+                    if (lowest < offset)
+                    {
+                        bins.insert(bins.begin(), static_cast<size_t>(offset - lowest), 0);
+                        offset = static_cast<int>(lowest);
+                    }
+                    collapsed |= index < offset;
+                    index = std::max(index, offset);
+                }
+                else if (static_cast<size_t>(index - offset) >= bins.size())
+                {
+                    int64_t lowest = static_cast<int64_t>(index) - static_cast<int64_t>(max_bins) + 1;
+                    if (lowest > offset)
+                        collapse_below(static_cast<int>(lowest));
+                    bins.resize(static_cast<size_t>(index - offset) + 1, 0);
+                }
+                bins[static_cast<size_t>(index - offset)] += n;
+            }
+
+            bool remove(int index)
+            {
+                if (collapsed && index < offset)
+                    index = offset;
+                if (index < offset || static_cast<size_t>(index - offset) >= bins.size())
+                    return false;
+                uint64_t &bin = bins[static_cast<size_t>(index - offset)];
+                if (bin == 0)
+                    return false;
+                --bin;
+                return true;
+            }
+
+            void clear()
+            {
+                bins.clear();
+                collapsed = false;
+            }
+        };
+
+        double accuracy;
+        double gamma;
+        double inv_log_gamma;
+        int max_index;       ///< Index of the bucket holding the largest finite double.
+        Store positive;
+        Store negative;      ///< Buckets of -x for negative x.
+        uint64_t zeros = 0;  ///< Zero and subnormal values.
+        uint64_t total = 0;
+
+        int index(double magnitude) const
+        {
+            double i = std::ceil(std::log(magnitude) * inv_log_gamma);
+            return i >= max_index ? max_index : static_cast<int>(i);
+        }
+
+        double value_of(int i) const
+        {
+            return 2 * std::pow(gamma, i) / (gamma + 1);
+        }
+
+    public:
+        /// @brief Finest supported accuracy; below it the bucket indices would not fit in int.
+        static constexpr double min_relative_accuracy = 1e-6;
+
+        /// @brief Default bucket limit per sign: at a = 0.01 it spans about 17 orders of magnitude.
+        static constexpr size_t default_max_bins = 2048;
+
+        /// @brief Creates an empty sketch.
+        /// @param relative_accuracy Bound a on |estimate - exact| / |exact|, in
+        /// [min_relative_accuracy, 1).
+        /// @param max_bins Buckets kept per sign before the lowest ones are collapsed.
+        /// @throws std::invalid_argument if relative_accuracy is out of range or max_bins is 0.
+        explicit QuantileSketch(double relative_accuracy = 0.01,
+                                std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+                                size_t max_bins = default_max_bins)
+            : accuracy(relative_accuracy), gamma(0), inv_log_gamma(0), max_index(0),
+              positive(max_bins, resource), negative(max_bins, resource)
+        {
+            if (!(relative_accuracy >= min_relative_accuracy && relative_accuracy < 1))
+            {
+                throw std::invalid_argument("Relative accuracy must be in [1e-6, 1)");
+            }
+            if (max_bins == 0)
+            {
+                throw std::invalid_argument("A quantile sketch needs at least one bucket");
+            }
+            gamma = (1 + relative_accuracy) / (1 - relative_accuracy);
+            inv_log_gamma = 1 / std::log(gamma);
+            max_index = static_cast<int>(std::ceil(std::log(std::numeric_limits<double>::max()) * inv_log_gamma));
+        }
+
+        /// @brief Counts x. NaN is ignored; infinities land in the outermost bucket.
+        void add(double x)
+        {
+            if (std::isnan(x))
+                return;
+            if (std::fabs(x) < std::numeric_limits<double>::min())
+                ++zeros;
+            else if (x > 0)
+                positive.add(index(x), 1);
+            else
+                negative.add(index(-x), 1);
+            ++total;
+        }
+
+        /// @brief Uncounts one x previously passed to add().
+        void remove(double x)
+        {
+            if (std::isnan(x))
+                return;
+            bool found;
+            if (std::fabs(x) < std::numeric_limits<double>::min())
+            {
+                found = zeros != 0;
+                zeros -= found;
+            }
+            else if (x > 0)
+                found = positive.remove(index(x));
+            else
+                found = negative.remove(index(-x));
+            total -= found;
+        }
+
+        /// @brief Adds other's counts to this sketch.
+        /// @throws std::invalid_argument if the two sketches use different accuracies.
+        void merge(const QuantileSketch &other)
+        {
+            if (other.accuracy != accuracy)
+            {
+                throw std::invalid_argument("Cannot merge sketches with different accuracy");
+            }
+            for (size_t k = 0; k < other.positive.bins.size(); ++k)
+                if (other.positive.bins[k] != 0)
+                    positive.add(other.positive.offset + static_cast<int>(k), other.positive.bins[k]);
+            for (size_t k = 0; k < other.negative.bins.size(); ++k)
+                if (other.negative.bins[k] != 0)
+                    negative.add(other.negative.offset + static_cast<int>(k), other.negative.bins[k]);
+            zeros += other.zeros;
+            total += other.total;
+        }
+
+        /// @brief Forgets every value; the accuracy is kept.
+        void clear()
+        {
+            positive.clear();
+            negative.clear();
+            zeros = total = 0;
+        }
+
+        /// @brief Estimate of the value at rank floor(q * (count() - 1)) in ascending order.
+        /// @details Walks the buckets, so the cost is at most 2 max_bins steps, however many
+        /// values were added. Quantiles that fall in a collapsed bucket are reported at the
+        /// lowest kept bucket, so their magnitude is overestimated.
+        /// @throws std::invalid_argument if q is not in [0, 1].
+        /// @throws std::runtime_error if the sketch is empty.
+        double quantile(double q) const
+        {
+            if (!(q >= 0 && q <= 1))
+            {
+                throw std::invalid_argument("Quantile must be in [0, 1]");
+            }
+            if (total == 0)
+            {
+                throw std::runtime_error("Container is empty");
+            }
+            uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1));
+            uint64_t seen = 0;
+            for (size_t k = negative.bins.size(); k-- > 0;)
+            {
+                seen += negative.bins[k];
+                if (seen > rank)
+                    return -value_of(negative.offset + static_cast<int>(k));
+            }
+            seen += zeros;
+            if (seen > rank)
+                return 0;
+            for (size_t k = 0; k < positive.bins.size(); ++k)
+            {
+                seen += positive.bins[k];
+                if (seen > rank)
+                    return value_of(positive.offset + static_cast<int>(k));
+            }
+            return value_of(positive.offset + static_cast<int>(positive.bins.size()) - 1);
+        }
+
+        /// @brief Number of values counted.
+        uint64_t count() const { return total; }
+
+        /// @brief Buckets currently allocated (at most 2 max_bins).
+        size_t bin_count() const { return positive.bins.size() + negative.bins.size(); }
+
+        /// @brief The relative accuracy the sketch was created with.
+        double relative_accuracy() const { return accuracy; }
+    };
+
+}
@@ -0,0 +1,231 @@
+// anksilae@gmail.com
+
+
+/// @brief DictionaryStorage: dictionary-encoded storage for low-cardinality std::string data.
+/// @details Every distinct string is stored once; elements are uint32_t codes into that
+/// dictionary. The dictionary is also kept in sorted order (code -> rank), so the sorted
+/// iterators can order n elements with an O(n + d) counting sort over ranks, and remove(),
+/// find() and count() compare integers instead of strings.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../simd/Kernels.hpp"
+
+namespace containers
+{
+
+    class DictionaryStorage
+    {
+    public:
+        using value_type = std::string;
+        using size_type = size_t;
+        using allocator_type = std::pmr::polymorphic_allocator<uint32_t>;
+
+    private:
+        struct Hash
+        {
+            using is_transparent = void;
+            size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+        };
+
+        std::pmr::vector<uint32_t> codes;                                           ///< One code per element.
+        std::pmr::unordered_map<std::pmr::string, uint32_t, Hash, std::equal_to<>> lookup; ///< Value -> code.
+        std::pmr::vector<const std::pmr::string *> values;                          ///< Code -> value (map nodes are stable).
+        std::pmr::vector<uint32_t> by_rank;                                         ///< Codes in ascending value order.
+        std::pmr::vector<uint32_t> rank;                                            ///< Code -> position in by_rank.
+        std::pmr::vector<size_t> counts;                                            ///< Code -> live elements.
+
+        /// @brief Returns the code of value, or the dictionary size if it was never seen.
+        uint32_t code_of(std::string_view value) const
+        {
+            auto it = lookup.find(value);
+            return it == lookup.end() ? static_cast<uint32_t>(values.size()) : it->second;
+        }
+
+        /// @brief Adds a new distinct value and slots it into the sorted order in O(d).
+        uint32_t intern(std::string_view value)
+        {
+            if (values.size() == std::numeric_limits<uint32_t>::max())
+            {
+                throw std::length_error("Dictionary is full");
+            }
+            uint32_t code = static_cast<uint32_t>(values.size());
+            auto node = lookup.emplace(std::pmr::string(value, lookup.get_allocator()), code).first;
+            values.push_back(&node->first);
+            counts.push_back(0);
+
+            auto pos = std::lower_bound(by_rank.begin(), by_rank.end(), value,
+                                        [this](uint32_t c, std::string_view v)
+                                        { return std::string_view(*values[c]) < v; });
+            size_t first_shifted = static_cast<size_t>(pos - by_rank.begin());
+            by_rank.insert(pos, code);
+            rank.push_back(0);
+            for (size_t r = first_shifted; r < by_rank.size(); ++r)
+                rank[by_rank[r]] = static_cast<uint32_t>(r);
+            return code;
+        }
+
+    public:
+        explicit DictionaryStorage(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+            : codes(resource), lookup(resource), values(resource), by_rank(resource), rank(resource), counts(resource) {}
+
+        // The value pointers refer to this object's map nodes, so copies rebuild the dictionary.
+        DictionaryStorage(const DictionaryStorage &other) : DictionaryStorage()
+        {
+            *this = other;
+        }
+
+        DictionaryStorage &operator=(const DictionaryStorage &other)
+        {
+            if (this != &other)
+            {
+                clear();
+                codes.reserve(other.codes.size());
+                for (size_t i = 0; i < other.codes.size(); ++i)
+                    push_back(*other.values[other.codes[i]]);
+            }
+            return *this;
+        }
+
+        DictionaryStorage(DictionaryStorage &&) = default;
+
+        DictionaryStorage &operator=(DictionaryStorage &&other)
+        {
+            if (this == &other)
+                return *this;
+            if (get_allocator() != other.get_allocator())
+            {
+                // Map nodes cannot change resource, so the value pointers would dangle.
+                return *this = other;
+            }
+            codes = std::move(other.codes);
+            lookup = std::move(other.lookup);
+            values = std::move(other.values);
+            by_rank = std::move(other.by_rank);
+            rank = std::move(other.rank);
+            counts = std::move(other.counts);
+            return *this;
+        }
+
+        allocator_type get_allocator() const { return codes.get_allocator(); }
+
+        void push_back(std::string_view value)
+        {
+            uint32_t code = code_of(value);
+            if (code == values.size())
+                code = intern(value);
+            codes.push_back(code);
+            ++counts[code];
+        }
+
+        void reserve(size_t n) { codes.reserve(n); }
+
+        /// @brief Removes all elements and forgets the dictionary.
+        void clear()
+        {
+            codes.clear();
+            lookup.clear();
+            values.clear();
+            by_rank.clear();
+            rank.clear();
+            counts.clear();
+        }
+
+        /// @brief Returns a copy of element i.
+        std::string operator[](size_t i) const { return std::string(*values[codes[i]]); }
+
+        /// @brief Returns a view of element i, valid while the container is alive.
+        std::string_view view(size_t i) const { return *values[codes[i]]; }
+
+        /// @brief Orders elements i and j by dictionary rank (same as comparing the strings).
+        bool less(size_t i, size_t j) const
+        {
+            return rank[codes[i]] < rank[codes[j]];
+        }
+
+        /// @brief Fills positions with 0..n-1 in ascending value order using a counting sort
+        /// over dictionary ranks: O(n + d) instead of O(n log n) string comparisons.
+        template <typename Positions>
+        void sort_positions(Positions &positions) const
+        {
+            using index_t = typename Positions::value_type;
+            std::pmr::vector<size_t> start(by_rank.size() + 1, 0, get_allocator().resource());
+            for (uint32_t c : codes)
+                ++start[rank[c] + 1];
+            for (size_t r = 1; r < start.size(); ++r)
+                start[r] += start[r - 1];
+            positions.resize(codes.size());
+            for (size_t i = 0; i < codes.size(); ++i)
+                positions[start[rank[codes[i]]]++] = static_cast<index_t>(i);
+        }
+
+        /// @brief Index of the first element equal to value, or size() if there is none.
+        size_t find(const std::string &value) const
+        {
+            uint32_t code = code_of(value);
+            if (code == values.size())
+                return codes.size();
+            // Same-width signed view of the codes lets the int kernels scan them.
+            return simd::find(reinterpret_cast<const int *>(codes.data()), codes.size(), static_cast<int>(code));
+        }
+
+        /// @brief Number of elements equal to value, read from the per-code counters.
+        size_t count(const std::string &value) const
+        {
+            uint32_t code = code_of(value);
+            return code == values.size() ? 0 : counts[code];
+        }
+
+        /// @brief Removes every element equal to value by comparing codes.
+        size_t remove(const std::string &value)
+        {
+            uint32_t code = code_of(value);
+            if (code == values.size() || counts[code] == 0)
+                return 0;
+            size_t kept = simd::remove(reinterpret_cast<int *>(codes.data()), codes.size(), static_cast<int>(code));
+            size_t removed = codes.size() - kept;
+            codes.resize(kept);
+            counts[code] = 0;
+            return removed;
+        }
+
+        /// @brief Removes every element for which pred returns true, keeping order.
+        /// @details pred runs once per element, in order, like for every other storage, so
+        /// stateful predicates behave the same. Each value is copied into one reused string.
+        template <typename Pred>
+        size_t remove_if(Pred pred)
+        {
+            std::string scratch;
+            size_t out = 0;
+            for (size_t i = 0; i < codes.size(); ++i)
+            {
+                uint32_t code = codes[i];
+                scratch.assign(*values[code]);
+                if (pred(std::as_const(scratch)))
+                    --counts[code];
+                else
+                    codes[out++] = code;
+            }
+            size_t removed = codes.size() - out;
+            codes.resize(out);
+            return removed;
+        }
+
+        /// @brief Number of distinct values ever added (the dictionary is append-only).
+        size_t dictionary_size() const { return values.size(); }
+
+        size_t size() const { return codes.size(); }
+        bool empty() const { return codes.empty(); }
+    };
+
+}
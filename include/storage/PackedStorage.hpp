@@ -0,0 +1,197 @@
+// anksilae@gmail.com
+
+
+/// @brief PackedStorage: compressed storage for integers with a small value range.
+/// @details Elements are grouped into blocks of 128. Each full block is stored as its minimum
+/// (frame of reference) plus 128 offsets bit-packed at the width of the block's range, so
+/// values that span 1000 take 10 bits instead of 32 or 64. The last, partial block stays
+/// unpacked until it fills up. Any element can be read in O(1) from its block header
+/// (operator[], used by the sorted orders). Sequential scans decode a whole block at a time
+/// (decode_block(), used by Normal/Reverse and for_each_segment()) with simd::unpack_bits,
+/// which gathers and shifts four fields per AVX2 instruction.
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+#include "../simd/Kernels.hpp"
+
+namespace containers
+{
+
+    template <typename T>
+    class PackedStorage
+    {
+        static_assert(std::is_integral_v<T> && sizeof(T) <= 8, "PackedStorage holds integers of up to 64 bits");
+
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using allocator_type = std::pmr::polymorphic_allocator<uint64_t>;
+        static constexpr size_t block_size = 128;
+
+    private:
+        using U = std::make_unsigned_t<T>;
+
+        struct Block
+        {
+            U base;          ///< Smallest value of the block.
+            uint32_t bits;   ///< Width of every packed offset.
+            uint64_t offset; ///< First word of the block in words.
+        };
+
+        std::pmr::vector<Block> blocks;   ///< Full, packed blocks.
+        std::pmr::vector<uint64_t> words; ///< Packed offsets of all full blocks.
+        std::array<T, block_size> tail{}; ///< The last, not yet full block.
+        size_t tail_count = 0;
+
+        static U extract(const uint64_t *w, size_t bitpos, uint32_t bits)
+        {
+            if (bits == 0)
+                return 0;
+            size_t word = bitpos >> 6;
+            uint32_t shift = static_cast<uint32_t>(bitpos & 63);
+            uint64_t v = w[word] >> shift;
+            if (shift + bits > 64)
+                v |= w[word + 1] << (64 - shift);
+            uint64_t mask = bits == 64 ? ~uint64_t{0} : ((uint64_t{1} << bits) - 1);
+            return static_cast<U>(v & mask);
+        }
+
+        /// @brief Packs the full tail into a new block.
+        void pack_tail()
+        {
+            // Compare as T, store differences as U: wrapping arithmetic handles negatives.
+            T min = tail[0], max = tail[0];
+            for (T v : tail)
+            {
+                min = v < min ? v : min;
+                max = v > max ? v : max;
+            }
+            U lo = static_cast<U>(min);
+            U hi = static_cast<U>(max);
+            uint32_t bits = static_cast<uint32_t>(std::bit_width(static_cast<uint64_t>(static_cast<U>(hi - lo))));
+            uint64_t offset = words.size();
+            words.resize(words.size() + block_size * bits / 64, 0);
+            uint64_t *w = words.data() + offset;
+            for (size_t k = 0; k < block_size && bits != 0; ++k)
+            {
+                uint64_t delta = static_cast<U>(static_cast<U>(tail[k]) - lo);
+                size_t bitpos = k * bits;
+                uint32_t shift = static_cast<uint32_t>(bitpos & 63);
+                w[bitpos >> 6] |= delta << shift;
+                if (shift + bits > 64)
+                    w[(bitpos >> 6) + 1] |= delta >> (64 - shift);
+            }
+            blocks.push_back(Block{lo, bits, offset});
+            tail_count = 0;
+        }
+
+    public:
+        explicit PackedStorage(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+            : blocks(resource), words(resource) {}
+
+        allocator_type get_allocator() const { return words.get_allocator(); }
+
+        void push_back(T value)
+        {
+            tail[tail_count++] = value;
+            if (tail_count == block_size)
+                pack_tail();
+        }
+
+        void reserve(size_t n) { blocks.reserve(n / block_size); }
+
+        void clear()
+        {
+            blocks.clear();
+            words.clear();
+            tail_count = 0;
+        }
+
+        /// @brief Returns element i, decoding only its own offset.
+        T operator[](size_t i) const
+        {
+            size_t b = i / block_size;
+            if (b == blocks.size())
+                return tail[i % block_size];
+            const Block &block = blocks[b];
+            return static_cast<T>(static_cast<U>(block.base + extract(words.data() + block.offset, (i % block_size) * block.bits, block.bits)));
+        }
+
+        /// @brief Decodes block b into out and returns its length (block_size except for the last one).
+        size_t decode_block(size_t b, T *out) const
+        {
+            if (b == blocks.size())
+            {
+                std::copy(tail.begin(), tail.begin() + static_cast<std::ptrdiff_t>(tail_count), out);
+                return tail_count;
+            }
+            const Block &block = blocks[b];
+            if constexpr (sizeof(T) == sizeof(uint64_t))
+            {
+                simd::unpack_bits(words.data() + block.offset, block.bits, block.base, block_size,
+                                  reinterpret_cast<uint64_t *>(out));
+            }
+            else
+            {
+                std::array<uint64_t, block_size> wide;
+                simd::unpack_bits(words.data() + block.offset, block.bits, block.base, block_size, wide.data());
+                for (size_t k = 0; k < block_size; ++k)
+                    out[k] = static_cast<T>(static_cast<U>(wide[k]));
+            }
+            return block_size;
+        }
+
+        /// @brief Calls f(data, n) on each block, decoded into a stack buffer.
+        template <typename F>
+        void for_each_segment(F &&f) const
+        {
+            std::array<T, block_size> decoded;
+            for (size_t b = 0; b * block_size < size(); ++b)
+            {
+                size_t n = decode_block(b, decoded.data());
+                f(static_cast<const T *>(decoded.data()), n);
+            }
+        }
+
+        /// @brief Removes every element for which pred returns true, keeping order; the
+        /// remaining elements are repacked.
+        template <typename Pred>
+        size_t remove_if(Pred pred)
+        {
+            PackedStorage kept(words.get_allocator().resource());
+            kept.reserve(size());
+            for_each_segment([&](const T *data, size_t n)
+                             {
+                                 for (size_t k = 0; k < n; ++k)
+                                     if (!pred(data[k]))
+                                         kept.push_back(data[k]); });
+            size_t removed = size() - kept.size();
+            if (removed != 0)
+                *this = std::move(kept);
+            return removed;
+        }
+
+        /// @brief Removes every element equal to value, keeping order.
+        size_t remove(T value)
+        {
+            return remove_if([value](T x)
+                             { return x == value; });
+        }
+
+        /// @brief Bytes used by the packed blocks, their headers and the unpacked tail.
+        size_t packed_bytes() const
+        {
+            return words.size() * sizeof(uint64_t) + blocks.size() * sizeof(Block) + sizeof(tail);
+        }
+
+        size_t size() const { return blocks.size() * block_size + tail_count; }
+        bool empty() const { return size() == 0; }
+    };
+
+}
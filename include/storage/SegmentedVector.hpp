@@ -0,0 +1,224 @@
+// anksilae@gmail.com
+
+
+/// @brief SegmentedVector: element storage made of fixed-size chunks.
+/// @details Appending never moves existing elements: when the last chunk is full a new one is
+/// allocated from the memory resource, so element addresses stay stable and growth never
+/// copies (or doubles the peak memory of) the whole container. Only the small table of chunk
+/// pointers is a regular vector.
+#pragma once
+#include <cstddef>
+#include <bit>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include "../simd/Kernels.hpp"
+
+namespace containers
+{
+
+    template <typename T, size_t ChunkSize = 4096>
+    class SegmentedVector
+    {
+        static_assert(ChunkSize != 0 && (ChunkSize & (ChunkSize - 1)) == 0,
+                      "ChunkSize must be a power of two");
+
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using allocator_type = std::pmr::polymorphic_allocator<T>;
+        static constexpr size_t chunk_size = ChunkSize;
+
+    private:
+        static constexpr size_t shift = static_cast<size_t>(std::countr_zero(ChunkSize));
+        static constexpr size_t mask = ChunkSize - 1;
+
+        std::pmr::vector<T *> chunks; ///< Each chunk holds ChunkSize slots.
+        size_t count = 0;
+
+        std::pmr::memory_resource *resource() const
+        {
+            return chunks.get_allocator().resource();
+        }
+
+        T *slot(size_t i) const
+        {
+            return chunks[i >> shift] + (i & mask);
+        }
+
+        void add_chunk()
+        {
+            T *chunk = static_cast<T *>(resource()->allocate(ChunkSize * sizeof(T), alignof(T)));
+            try
+            {
+                chunks.push_back(chunk);
+            }
+            catch (...)
+            {
+                resource()->deallocate(chunk, ChunkSize * sizeof(T), alignof(T));
+                throw;
+            }
+        }
+
+        /// @brief Frees the chunks that are no longer needed for count elements.
+        void release_chunks(size_t keep)
+        {
+            while (chunks.size() > keep)
+            {
+                resource()->deallocate(chunks.back(), ChunkSize * sizeof(T), alignof(T));
+                chunks.pop_back();
+            }
+        }
+
+        /// @brief Runs compact_chunk(chunk, len) -> kept on every chunk, then closes the gaps.
+        /// @details Each chunk is compacted in place (so the vector kernels apply), and the kept
+        /// prefix is then moved down to the global write position, which always lies in an
+        /// earlier chunk once something has been removed.
+        template <typename CompactChunk>
+        size_t compact(CompactChunk compact_chunk)
+        {
+            size_t out = 0;
+            for (size_t c = 0; c * ChunkSize < count; ++c)
+            {
+                size_t len = std::min(ChunkSize, count - c * ChunkSize);
+                T *src = chunks[c];
+                size_t kept = compact_chunk(src, len);
+                if (out != c * ChunkSize)
+                {
+                    for (size_t done = 0; done < kept;)
+                    {
+                        size_t pos = out + done;
+                        size_t piece = std::min(ChunkSize - (pos & mask), kept - done);
+                        std::move(src + done, src + done + piece, slot(pos));
+                        done += piece;
+                    }
+                }
+                out += kept;
+            }
+            size_t removed = count - out;
+            for (size_t i = out; i < count; ++i)
+                std::destroy_at(slot(i));
+            count = out;
+            release_chunks((count + ChunkSize - 1) >> shift);
+            return removed;
+        }
+
+    public:
+        /// @brief Creates an empty vector whose chunks come from the given resource.
+        explicit SegmentedVector(std::pmr::memory_resource *res = std::pmr::get_default_resource())
+            : chunks(res) {}
+
+        /// @brief Copies other; like std::pmr::vector the copy uses the default resource.
+        SegmentedVector(const SegmentedVector &other) : SegmentedVector()
+        {
+            for (size_t i = 0; i < other.count; ++i)
+                push_back(other[i]);
+        }
+
+        SegmentedVector(SegmentedVector &&other) noexcept
+            : chunks(std::move(other.chunks)), count(other.count)
+        {
+            other.count = 0;
+        }
+
+        SegmentedVector &operator=(const SegmentedVector &other)
+        {
+            if (this != &other)
+            {
+                clear();
+                for (size_t i = 0; i < other.count; ++i)
+                    push_back(other[i]);
+            }
+            return *this;
+        }
+
+        SegmentedVector &operator=(SegmentedVector &&other)
+        {
+            if (this == &other)
+                return *this;
+            clear();
+            if (resource()->is_equal(*other.resource()))
+            {
+                release_chunks(0);
+                chunks.swap(other.chunks);
+                count = other.count;
+                other.count = 0;
+            }
+            else
+            {
+                // Chunks cannot change owner across resources; move element by element.
+                for (size_t i = 0; i < other.count; ++i)
+                    push_back(std::move(other[i]));
+                other.clear();
+            }
+            return *this;
+        }
+
+        ~SegmentedVector()
+        {
+            clear();
+            release_chunks(0);
+        }
+
+        allocator_type get_allocator() const { return allocator_type(resource()); }
+
+        /// @brief Appends a value. Never relocates existing elements.
+        void push_back(const T &value)
+        {
+            if (count == chunks.size() * ChunkSize)
+                add_chunk();
+            ::new (static_cast<void *>(slot(count))) T(value);
+            ++count;
+        }
+
+        /// @brief Allocates chunks up front for n elements.
+        void reserve(size_t n)
+        {
+            size_t needed = (n + ChunkSize - 1) >> shift;
+            chunks.reserve(needed);
+            while (chunks.size() < needed)
+                add_chunk();
+        }
+
+        /// @brief Destroys all elements; allocated chunks are kept for reuse.
+        void clear()
+        {
+            for (size_t i = 0; i < count; ++i)
+                std::destroy_at(slot(i));
+            count = 0;
+        }
+
+        /// @brief Removes every element equal to value, keeping order.
+        /// @return The number of removed elements.
+        size_t remove(const T &value)
+        {
+            return compact([&value](T *chunk, size_t len)
+                           { return simd::remove(chunk, len, value); });
+        }
+
+        /// @brief Removes every element for which pred returns true, keeping order.
+        /// @return The number of removed elements.
+        template <typename Pred>
+        size_t remove_if(Pred pred)
+        {
+            return compact([&pred](T *chunk, size_t len)
+                           { return simd::remove_if(chunk, len, pred); });
+        }
+
+        /// @brief Calls f(data, n) on each chunk's contiguous run of elements, in order.
+        template <typename F>
+        void for_each_segment(F &&f) const
+        {
+            for (size_t c = 0; c * ChunkSize < count; ++c)
+                f(static_cast<const T *>(chunks[c]), std::min(ChunkSize, count - c * ChunkSize));
+        }
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        T &operator[](size_t i) { return *slot(i); }
+        const T &operator[](size_t i) const { return *slot(i); }
+    };
+
+}
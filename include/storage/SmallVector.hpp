@@ -0,0 +1,214 @@
+// anksilae@gmail.com
+
+
+/// @brief SmallVector: a vector that keeps up to N elements inside the object itself.
+/// @details Past N elements it spills to a buffer taken from a std::pmr::memory_resource, the
+/// same way std::pmr::vector does. Used as MyContainer storage for many tiny containers and
+/// for the index permutations of small iterators, so neither touches the heap.
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+namespace containers
+{
+
+    template <typename T, size_t N>
+    class SmallVector
+    {
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using iterator = T *;
+        using const_iterator = const T *;
+        using allocator_type = std::pmr::polymorphic_allocator<T>;
+
+    private:
+        T *first;       ///< Either the inline buffer or a spilled heap buffer.
+        size_t count = 0;
+        size_t cap = N;
+        std::pmr::memory_resource *resource;
+        alignas(T) std::byte buffer[N == 0 ? 1 : N * sizeof(T)];
+
+        T *inline_data()
+        {
+            return std::launder(reinterpret_cast<T *>(buffer));
+        }
+
+        void release()
+        {
+            if (!uses_inline_storage())
+                resource->deallocate(first, cap * sizeof(T), alignof(T));
+        }
+
+        /// @brief Moves the elements into a heap buffer of at least min_cap slots.
+        void grow(size_t min_cap)
+        {
+            size_t new_cap = std::max(min_cap, cap * 2);
+            T *fresh = static_cast<T *>(resource->allocate(new_cap * sizeof(T), alignof(T)));
+            std::uninitialized_move(first, first + count, fresh);
+            std::destroy(first, first + count);
+            release();
+            first = fresh;
+            cap = new_cap;
+        }
+
+        /// @brief Takes over other's elements, stealing its heap buffer when it has one.
+        void take(SmallVector &other)
+        {
+            if (other.uses_inline_storage())
+            {
+                std::uninitialized_move(other.first, other.first + other.count, first);
+                count = other.count;
+                std::destroy(other.first, other.first + other.count);
+            }
+            else
+            {
+                first = other.first;
+                count = other.count;
+                cap = other.cap;
+                other.first = other.inline_data();
+                other.cap = N;
+            }
+            other.count = 0;
+        }
+
+    public:
+        /// @brief Creates an empty vector that spills to the given resource.
+        explicit SmallVector(std::pmr::memory_resource *res = std::pmr::get_default_resource())
+            : first(inline_data()), resource(res) {}
+
+        /// @brief Copies other; like std::pmr::vector the copy uses the default resource.
+        SmallVector(const SmallVector &other) : SmallVector()
+        {
+            reserve(other.count);
+            std::uninitialized_copy(other.first, other.first + other.count, first);
+            count = other.count;
+        }
+
+        SmallVector(SmallVector &&other) noexcept : first(inline_data()), resource(other.resource)
+        {
+            take(other);
+        }
+
+        SmallVector &operator=(const SmallVector &other)
+        {
+            if (this != &other)
+            {
+                clear();
+                reserve(other.count);
+                std::uninitialized_copy(other.first, other.first + other.count, first);
+                count = other.count;
+            }
+            return *this;
+        }
+
+        SmallVector &operator=(SmallVector &&other) noexcept
+        {
+            if (this != &other)
+            {
+                clear();
+                if (resource == other.resource || other.uses_inline_storage())
+                {
+                    release();
+                    first = inline_data();
+                    cap = N;
+                    take(other);
+                }
+                else
+                {
+                    // Different resources: the buffer cannot change owner, move element-wise.
+                    reserve(other.count);
+                    std::uninitialized_move(other.first, other.first + other.count, first);
+                    count = other.count;
+                    other.clear();
+                }
+            }
+            return *this;
+        }
+
+        ~SmallVector()
+        {
+            clear();
+            release();
+        }
+
+        /// @brief True while the elements still live in the in-object buffer.
+        bool uses_inline_storage() const
+        {
+            return first == reinterpret_cast<const T *>(buffer);
+        }
+
+        allocator_type get_allocator() const { return allocator_type(resource); }
+
+        void push_back(const T &value)
+        {
+            if (count == cap)
+            {
+                T copy(value); // value may live in the buffer that grow() releases
+                grow(count + 1);
+                ::new (static_cast<void *>(first + count)) T(std::move(copy));
+            }
+            else
+            {
+                ::new (static_cast<void *>(first + count)) T(value);
+            }
+            ++count;
+        }
+
+        void reserve(size_t n)
+        {
+            if (n > cap)
+                grow(n);
+        }
+
+        /// @brief Resizes to n elements, value-initializing new ones.
+        void resize(size_t n)
+        {
+            if (n < count)
+            {
+                std::destroy(first + n, first + count);
+            }
+            else
+            {
+                reserve(n);
+                std::uninitialized_value_construct(first + count, first + n);
+            }
+            count = n;
+        }
+
+        void clear()
+        {
+            std::destroy(first, first + count);
+            count = 0;
+        }
+
+        /// @brief Erases [from, to), shifting the tail down.
+        iterator erase(const_iterator from, const_iterator to)
+        {
+            T *dst = first + (from - first);
+            T *src = first + (to - first);
+            T *new_end = std::move(src, first + count, dst);
+            std::destroy(new_end, first + count);
+            count = static_cast<size_t>(new_end - first);
+            return dst;
+        }
+
+        T *data() { return first; }
+        const T *data() const { return first; }
+        size_t size() const { return count; }
+        size_t capacity() const { return cap; }
+        bool empty() const { return count == 0; }
+        T &operator[](size_t i) { return first[i]; }
+        const T &operator[](size_t i) const { return first[i]; }
+        iterator begin() { return first; }
+        iterator end() { return first + count; }
+        const_iterator begin() const { return first; }
+        const_iterator end() const { return first + count; }
+    };
+
+}
@@ -0,0 +1,194 @@
+// anksilae@gmail.com
+
+
+/// @brief StringArena: storage for MyContainer<std::string> that packs all characters together.
+/// @details Each element is a small record (offset, length, first 8 bytes). Strings of up to
+/// 8 bytes live entirely in the record; longer ones point into one contiguous byte arena.
+/// Comparisons look at the 8-byte prefix as a single integer first and only touch the arena
+/// on a tie, so sorting and remove() rarely leave the record array.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <limits>
+
+namespace containers
+{
+
+    class StringArena
+    {
+    public:
+        using value_type = std::string;
+        using size_type = size_t;
+        using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    private:
+        struct Record
+        {
+            uint64_t offset;   ///< Start in bytes (only used when length > 8).
+            uint32_t length;
+            char prefix[8];    ///< First 8 bytes, zero padded.
+        };
+
+        std::pmr::vector<Record> records;
+        std::pmr::vector<char> bytes;
+        size_t live_bytes = 0; ///< Arena bytes still referenced by a record.
+
+        static Record make_record(std::string_view s, uint64_t offset)
+        {
+            if (s.size() > std::numeric_limits<uint32_t>::max())
+            {
+                throw std::length_error("String too long for StringArena");
+            }
+            Record r{offset, static_cast<uint32_t>(s.size()), {}};
+            std::memcpy(r.prefix, s.data(), s.size() < 8 ? s.size() : 8);
+            return r;
+        }
+
+        /// @brief The prefix as an integer whose order matches lexicographic byte order.
+        static uint64_t key(const Record &r)
+        {
+            uint64_t k;
+            std::memcpy(&k, r.prefix, 8);
+            if constexpr (std::endian::native == std::endian::little)
+                k = __builtin_bswap64(k);
+            return k;
+        }
+
+        std::string_view view(const Record &r) const
+        {
+            return r.length <= 8 ? std::string_view(r.prefix, r.length)
+                                 : std::string_view(bytes.data() + r.offset, r.length);
+        }
+
+        /// @brief Equality test that rejects on length and prefix before touching the arena.
+        bool matches(const Record &r, const Record &probe, std::string_view value) const
+        {
+            return r.length == probe.length && std::memcmp(r.prefix, probe.prefix, 8) == 0 &&
+                   (r.length <= 8 || std::memcmp(bytes.data() + r.offset, value.data(), r.length) == 0);
+        }
+
+        /// @brief Rewrites the arena when more than half of it belongs to removed strings.
+        void maybe_compact_bytes()
+        {
+            if (live_bytes * 2 >= bytes.size())
+                return;
+            std::pmr::vector<char> fresh(bytes.get_allocator());
+            fresh.reserve(live_bytes);
+            for (Record &r : records)
+            {
+                if (r.length > 8)
+                {
+                    uint64_t offset = fresh.size();
+                    fresh.insert(fresh.end(), bytes.begin() + static_cast<std::ptrdiff_t>(r.offset),
+                                 bytes.begin() + static_cast<std::ptrdiff_t>(r.offset + r.length));
+                    r.offset = offset;
+                }
+            }
+            bytes.swap(fresh);
+        }
+
+        /// @brief Drops the records for which drop(i) is true; returns how many were dropped.
+        template <typename Drop>
+        size_t compact_records(Drop drop)
+        {
+            size_t out = 0;
+            for (size_t i = 0; i < records.size(); ++i)
+            {
+                Record r = records[i];
+                bool gone = drop(r);
+                records[out] = r;
+                out += !gone;
+                live_bytes -= (gone && r.length > 8) ? r.length : 0;
+            }
+            size_t removed = records.size() - out;
+            records.resize(out);
+            maybe_compact_bytes();
+            return removed;
+        }
+
+    public:
+        explicit StringArena(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+            : records(resource), bytes(resource) {}
+
+        allocator_type get_allocator() const { return allocator_type(bytes.get_allocator().resource()); }
+
+        void push_back(std::string_view s)
+        {
+            Record r = make_record(s, bytes.size());
+            if (s.size() > 8)
+            {
+                bytes.insert(bytes.end(), s.begin(), s.end());
+                live_bytes += s.size();
+            }
+            records.push_back(r);
+        }
+
+        void reserve(size_t n) { records.reserve(n); }
+
+        /// @brief Returns a view of element i; valid until the next push_back or removal.
+        std::string_view view(size_t i) const { return view(records[i]); }
+
+        /// @brief Returns a copy of element i (the iterators hand out values, not references).
+        std::string operator[](size_t i) const { return std::string(view(records[i])); }
+
+        /// @brief Orders elements i and j like std::string's operator<.
+        bool less(size_t i, size_t j) const
+        {
+            const Record &a = records[i], &b = records[j];
+            uint64_t ka = key(a), kb = key(b);
+            if (ka != kb)
+                return ka < kb;
+            return view(a) < view(b);
+        }
+
+        /// @brief Index of the first element equal to value, or size() if there is none.
+        size_t find(const std::string &value) const
+        {
+            Record probe = make_record(value, 0);
+            for (size_t i = 0; i < records.size(); ++i)
+                if (matches(records[i], probe, value))
+                    return i;
+            return records.size();
+        }
+
+        /// @brief Number of elements equal to value.
+        size_t count(const std::string &value) const
+        {
+            Record probe = make_record(value, 0);
+            size_t hits = 0;
+            for (const Record &r : records)
+                hits += matches(r, probe, value);
+            return hits;
+        }
+
+        /// @brief Removes every element equal to value, keeping order.
+        size_t remove(const std::string &value)
+        {
+            Record probe = make_record(value, 0);
+            return compact_records([&](const Record &r)
+                                   { return matches(r, probe, value); });
+        }
+
+        /// @brief Removes every element for which pred(std::string) returns true, keeping order.
+        template <typename Pred>
+        size_t remove_if(Pred pred)
+        {
+            return compact_records([&](const Record &r)
+                                   { return static_cast<bool>(pred(std::string(view(r)))); });
+        }
+
+        /// @brief Bytes currently held by the arena, including removed strings not yet compacted.
+        size_t arena_bytes() const { return bytes.size(); }
+
+        size_t size() const { return records.size(); }
+        bool empty() const { return records.empty(); }
+    };
+
+}
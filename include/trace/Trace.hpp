@@ -0,0 +1,222 @@
+// anksilae@gmail.com
+
+
+/// @brief Phase-level tracing in the Chrome trace event format (chrome://tracing, Perfetto).
+/// @details CONTAINERS_TRACE_SCOPE(name, size) marks a phase: index construction, sorting,
+/// materialization, compaction, growth in add(), bulk loading and external-sort run writes.
+/// Tracing is off until Tracer::instance().enable(); while off a scope costs one relaxed load.
+/// Defining CONTAINERS_NO_TRACE before including any container header removes the scopes
+/// entirely. Finished scopes are buffered in memory and written with write_chrome_json(); the
+/// buffer is a ring of set_capacity() events (65536 by default) that keeps the newest ones.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace containers::trace
+{
+
+    /// @brief One finished scope, a Chrome "complete" (ph = X) event.
+    struct Event
+    {
+        const char *name;   ///< Phase name; must be a string literal.
+        uint64_t start_us;  ///< Microseconds since the tracer was created.
+        uint64_t duration_us;
+        uint32_t thread;    ///< Small sequential id of the recording thread.
+        uint64_t size;      ///< Elements involved (shown as args.n).
+    };
+
+    /// @brief Process-wide event buffer.
+    class Tracer
+    {
+    private:
+        std::atomic<bool> on{false};
+        std::mutex lock;
+        std::vector<Event> events; ///< Ring buffer; once full, events[head] is the oldest.
+        size_t head = 0;
+        size_t limit = size_t{1} << 16;
+        uint64_t overwritten = 0;
+        std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+        Tracer() = default;
+
+        /// @brief The buffered events, oldest first. The caller holds lock.
+        std::vector<Event> in_order() const
+        {
+            std::vector<Event> out;
+            out.reserve(events.size());
+            out.insert(out.end(), events.begin() + static_cast<std::ptrdiff_t>(head), events.end());
+            out.insert(out.end(), events.begin(), events.begin() + static_cast<std::ptrdiff_t>(head));
+            return out;
+        }
+
+        static void escape(std::string &out, const char *text)
+        {
+            for (; *text; ++text)
+            {
+                if (*text == '"' || *text == '\\')
+                    out += '\\';
+                out += *text;
+            }
+        }
+
+    public:
+        static Tracer &instance()
+        {
+            static Tracer tracer;
+            return tracer;
+        }
+
+        void enable() { on.store(true, std::memory_order_relaxed); }
+        void disable() { on.store(false, std::memory_order_relaxed); }
+        bool enabled() const { return on.load(std::memory_order_relaxed); }
+
+        /// @brief Microseconds since the tracer was created.
+        uint64_t now_us() const
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                             std::chrono::steady_clock::now() - origin)
+                                             .count());
+        }
+
+        /// @brief Id of the calling thread, assigned on its first event.
+        static uint32_t thread_id()
+        {
+            static std::atomic<uint32_t> next{1};
+            thread_local uint32_t id = next.fetch_add(1, std::memory_order_relaxed);
+            return id;
+        }
+
+        /// @brief Buffers event, overwriting the oldest one when the ring is full.
+        void record(const Event &event)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (events.size() < limit)
+            {
+                events.push_back(event);
+                return;
+            }
+            ++overwritten;
+            if (limit == 0)
+                return;
+            events[head] = event;
+            head = (head + 1) % limit;
+        }
+
+        /// @brief Keeps at most max_events events (the newest); 0 records nothing.
+        void set_capacity(size_t max_events)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            std::vector<Event> kept = in_order();
+            if (kept.size() > max_events)
+            {
+                overwritten += kept.size() - max_events;
+                kept.erase(kept.begin(), kept.end() - static_cast<std::ptrdiff_t>(max_events));
+            }
+            events = std::move(kept);
+            head = 0;
+            limit = max_events;
+        }
+
+        /// @brief Events lost to the ring buffer since the last clear().
+        uint64_t dropped()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return overwritten;
+        }
+
+        /// @brief Copy of the buffered events, oldest first.
+        std::vector<Event> snapshot()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return in_order();
+        }
+
+        void clear()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            events.clear();
+            head = 0;
+            overwritten = 0;
+        }
+
+        /// @brief The recorded events as a Chrome trace JSON document.
+        std::string to_chrome_json()
+        {
+            std::string out = "{\"traceEvents\":[";
+            std::vector<Event> ordered = snapshot();
+            for (size_t i = 0; i < ordered.size(); ++i)
+            {
+                const Event &e = ordered[i];
+                out += i == 0 ? "\n" : ",\n";
+                out += "{\"name\":\"";
+                escape(out, e.name);
+                out += "\",\"cat\":\"containers\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(e.thread) +
+                       ",\"ts\":" + std::to_string(e.start_us) + ",\"dur\":" + std::to_string(e.duration_us) +
+                       ",\"args\":{\"n\":" + std::to_string(e.size) + "}}";
+            }
+            out += "\n],\"displayTimeUnit\":\"ms\"}\n";
+            return out;
+        }
+
+        /// @brief Writes to_chrome_json() to path.
+        /// @throws std::runtime_error if the file cannot be written.
+        void write_chrome_json(const std::string &path)
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out << to_chrome_json();
+            if (!out)
+            {
+                throw std::runtime_error("Cannot write trace file " + path);
+            }
+        }
+    };
+
+    /// @brief Records the enclosing block as an event if tracing was on when it started.
+    class Scope
+    {
+    private:
+        const char *name;
+        uint64_t size;
+        uint64_t start = 0;
+        bool active;
+
+    public:
+        explicit Scope(const char *phase, uint64_t n = 0)
+            : name(phase), size(n), active(Tracer::instance().enabled())
+        {
+            if (active)
+                start = Tracer::instance().now_us();
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        ~Scope()
+        {
+            if (active)
+            {
+                Tracer &tracer = Tracer::instance();
+                tracer.record({name, start, tracer.now_us() - start, Tracer::thread_id(), size});
+            }
+        }
+    };
+
+}
+
+#define CONTAINERS_TRACE_CAT2(a, b) a##b
+#define CONTAINERS_TRACE_CAT(a, b) CONTAINERS_TRACE_CAT2(a, b)
+
+#ifdef CONTAINERS_NO_TRACE
+#define CONTAINERS_TRACE_SCOPE(...) ((void)0)
+#else
+/// @brief CONTAINERS_TRACE_SCOPE("phase") or CONTAINERS_TRACE_SCOPE("phase", n): traces the rest of the block.
+#define CONTAINERS_TRACE_SCOPE(...) \
+    ::containers::trace::Scope CONTAINERS_TRACE_CAT(containers_trace_scope_, __LINE__)(__VA_ARGS__)
+#endif